@@ -0,0 +1,6 @@
+#pragma once
+
+#include <cstddef>
+
+// The number of heap allocations made by the program so far.
+size_t allocation_count();
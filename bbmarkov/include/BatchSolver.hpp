@@ -0,0 +1,33 @@
+#pragma once
+
+#include <Solver.hpp>
+#include <mutex>
+#include <atomic>
+
+// Reads the score files listed one per line, skipping empty lines and # comments
+bool read_manifest(const std::string&, std::vector<std::string>&);
+
+// Solves the score files listed in a manifest on -j threads, one instance per
+// thread at a time. Each thread keeps the best parent set tables, the Bayes table
+// and the -o table of its previous instance, so instances of the same size reuse
+// them.
+class BatchSolver {
+public:
+    BatchSolver(const Settings&);
+    
+    bool read_manifest(const std::string&);
+    void solve();
+
+protected:
+    void work();
+    void solve(const std::string&, std::vector<ScoreTree>&, std::vector<Score>&,
+        TranspositionTable&);
+    void output(const std::string&);
+
+private:
+    Settings settings;
+    uint workers;
+    std::vector<std::string> files;
+    std::atomic<size_t> next;
+    std::mutex guard;
+};
@@ -4,23 +4,80 @@
 #include <ParentSet.hpp>
 #include <ScoreTree.hpp>
 #include <Moralizer.hpp>
+#include <MappedFile.hpp>
 
 class BayesSolver {
 public:    
     BayesSolver(Instance&, uint);
 
-    void construct_solution(ArcMatrix&, std::bitset<32>) const;
+    void construct_solution(ArcMatrix&, VarSet) const;
+    
+    bool fits(size_t, size_t) const;
+    
+    bool fill(uint, size_t);
+    bool fill(uint, size_t, const std::string&);
+    
+    // Exchanges the in-memory table with a buffer of another solver. Only the
+    // capacity carries over; fill() overwrites the contents.
+    inline void swap_table(std::vector<Score>& buffer) {
+        scores.swap(buffer);
+        scores.clear();
+    }
 
-    Score solve(std::bitset<32>);
+    inline Score solve(const VarSet& assigned) const {
+        return is_filled()? value(assigned.to_ulong()): relaxed(assigned);
+    }
+    
+    void solve_children(const VarSet&, std::vector<Score>&) const;
+    
+    inline bool is_filled() const {
+        return table || !scores.empty();
+    }
+    
+    inline const MappedFile * mapping() const {
+        return table? &file: nullptr;
+    }
+    
+    inline bool was_reused() const {
+        return reused;
+    }
 
 protected:
-    uint find_best_variable(std::bitset<32>) const;
-    size_t find_best_parentset(uint, const std::bitset<32>&) const;
+    uint find_best_variable(VarSet) const;
+    size_t find_best_parentset(uint, const VarSet&) const;
     
-    void assign_next_variable(ArcMatrix&, std::bitset<32>&) const;
+    void assign_next_variable(ArcMatrix&, VarSet&) const;
+    
+    inline size_t position(size_t subset) const {
+        size_t rank = 0;
+        uint k = 0;
+        for(; subset; subset &= subset - 1)
+            rank += binomials[__builtin_ctzll(subset)][++k];
+        return offsets[k] + rank;
+    }
+    
+    inline Score value(size_t subset) const {
+        return table? table[position(subset)]: scores[subset];
+    }
+    
+    void store(uint, size_t, size_t, Score);
+    
+    Score relaxed(const VarSet&) const;
+    
+    Score evaluate(size_t) const;
+    void fill_layer(uint, size_t, size_t);
+    void fill_layers(uint);
 
 private:
     Instance& instance;
     uint N;
     std::vector<Score> scores;
-};
\ No newline at end of file
+    std::vector<Score> best_scores;
+    
+    MappedFile file;
+    float * table;
+    bool reused;
+    
+    size_t binomials[33][33];
+    size_t offsets[34];
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <Solver.hpp>
+#include <string>
+#include <vector>
+
+// Solves every score file of a manifest with each set of flags and prints a CSV
+// row per run. Each run is forked so that its peak resident memory is its own.
+class Benchmark {
+public:
+    Benchmark(const Settings&, const std::string&);
+    
+    bool read_manifest(const std::string&);
+    void run();
+
+protected:
+    void run(const std::string&, const std::string&);
+
+private:
+    Settings settings;
+    std::vector<std::string> files, flag_sets;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <ParentSet.hpp>
+#include <vector>
+#include <string>
+
+// The state of an interrupted depth-first search: the position of the current
+// node as the option index chosen at each depth, the incumbent as parent set
+// indices and the counters that are reported at the end. The instance is named
+// by its absolute path and identified by the checksum of its scores.
+struct Checkpoint {
+    std::string instance, flags;
+    size_t checksum;
+    uint variables;
+    
+    std::vector<size_t> positions, options;
+    
+    Score score;
+    std::vector<size_t> parentsets;
+    
+    size_t elapsed;
+    std::vector<size_t> layer_visits;
+    size_t recurring_skeletons, option_hits, tight_UBs, successful_tight_UBs;
+    
+    Checkpoint():
+        checksum(0),
+        variables(0),
+        score(-INF),
+        elapsed(0),
+        recurring_skeletons(0),
+        option_hits(0),
+        tight_UBs(0),
+        successful_tight_UBs(0) {}
+    
+    bool write(const std::string&) const;
+    bool read(const std::string&);
+};
+
+// The absolute path of an existing file, so that a checkpoint can be resumed
+// from another directory; other names are returned as they are.
+std::string absolute_path(const std::string&);
+
+// SIGTERM and SIGINT only raise a flag; the solver writes a final checkpoint
+// when it next looks at it.
+void catch_termination();
+bool termination_requested();
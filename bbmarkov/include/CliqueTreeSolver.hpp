@@ -0,0 +1,97 @@
+#pragma once
+
+#include <Solver.hpp>
+#include <string>
+#include <vector>
+
+// The tables grow as 3^N, so larger instances are left to the branch and bound
+#define MAX_CLIQUE_TREE_VARIABLES 18
+
+// Exact dynamic programming over junction trees. A chordal network scores the
+// sum of its clique scores minus the sum of its separator scores, where the score
+// of a set is that of any complete DAG on it. That only holds for score-equivalent
+// scores that list every parent set up to the limit, which prepare() checks.
+//
+// With R and U outside the sets S and C:
+//   g(S, R)  the best subtree that hangs from the separator S and covers R
+//   a(C, R)  the best g(S, R) among the separators S within the clique C
+//   h(C, U)  the best way of hanging U from the clique C in disjoint subtrees
+// The tables of a set are indexed by subsets of its complement, with the bits of
+// the set squeezed out, and they are filled in the order of |R| and |U|.
+class CliqueTreeSolver {
+public:
+    CliqueTreeSolver(const Settings&, Instance&);
+    
+    bool prepare(std::string&);
+    void solve();
+    
+    inline const Solution& solution() const {
+        return best;
+    }
+    
+    inline size_t time() const {
+        return search_time;
+    }
+    
+    inline size_t states() const {
+        return state_count;
+    }
+
+protected:
+    struct Separator {
+        uint id;
+        std::vector<uint> positions;
+    };
+    
+    inline uint32_t mask_of(uint id) const {
+        return sets[id];
+    }
+    
+    inline uint width(uint id) const {
+        return N - __builtin_popcount(sets[id]);
+    }
+    
+    // The i:th vertex outside the set
+    inline uint outside(uint id, uint i) const {
+        return outsiders[id * N + i];
+    }
+    
+    static inline uint32_t remove_bit(uint32_t subset, uint position) {
+        return (subset & ((1u << position) - 1)) | ((subset >> (position + 1)) << position);
+    }
+    
+    static inline uint32_t insert_bit(uint32_t subset, uint position) {
+        return (subset & ((1u << position) - 1)) | ((subset >> position) << (position + 1));
+    }
+    
+    uint32_t squeeze(uint32_t, uint32_t) const;
+    Score local_score(uint, uint32_t) const;
+    
+    template<typename Function>
+    void parallel_for(size_t, const Function&);
+    
+    void fill_separator(uint, uint);
+    void fill_clique(uint, uint);
+    Score extend(uint, uint32_t, uint, Score);
+    
+    void build_subtree(uint32_t, uint32_t, ArcMatrix&);
+    void build_children(uint32_t, uint32_t, ArcMatrix&);
+    
+    void output();
+
+private:
+    Settings settings;
+    Instance& instance;
+    uint N, K;
+    size_t start_time, search_time, state_count, memory;
+    
+    std::vector<uint32_t> sets;
+    std::vector<int> set_ids;
+    std::vector<Score> set_scores;
+    std::vector<uint8_t> outsiders;
+    std::vector<std::vector<Separator> > separators;
+    std::vector<std::vector<Score> > g, a, h;
+    
+    Score optimum;
+    Solution best;
+};
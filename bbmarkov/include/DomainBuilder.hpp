@@ -3,44 +3,45 @@
 #include <ParentSet.hpp>
 #include <Instance.hpp>
 #include <Solution.hpp>
-#include <set>
-#include <unordered_map>
-#include <functional>
+#include <TranspositionTable.hpp>
+#include <MarkovBounder.hpp>
+#include <vector>
 #include <debug.hpp>
 
-typedef std::function<Score(uint, size_t)> ValueCalculator;
-
-struct OptionsSort {
-    ValueCalculator * calculate_ub;
-    const Domains& domains;
+// An option together with the value it is ordered by. The value is calculated once,
+// when the option is found, instead of on every comparison.
+struct Option {
+    Score key;
+    size_t option;
     
-    bool operator()(size_t, size_t) const;
-};
-
-typedef std::set<size_t, OptionsSort> OptionList;
-
-struct OptionsHash {
-    inline size_t operator()(const OptionList& list) const {
-        size_t hash = 0;
-        for(size_t value: list)
-            hash ^= (value * 1103515245 + 12345) % ((size_t(1) << 31) - 1);
-        return hash;
+    inline bool operator<(const Option& other) const {
+        if(key != other.key)
+            return key > other.key;
+        return option < other.option;
     }
 };
 
-struct OptionsCompare {
-    inline bool operator()(const OptionList& a, const OptionList& b) const {
-        if(a.size() != b.size())
-            return false;
-        auto it1 = a.begin();
-        auto it2 = b.begin();
-        while(it1 != a.end()) {
-            if(*it1 != *it2)
-                return false;
-            it1++;
-            it2++;
+typedef std::vector<Option> OptionList;
+
+// Best scores found among the supersets of each parent set during construct_for(),
+// indexed by the parent set. Entries from earlier calls are told apart by their
+// stamps, so the arrays are allocated once and only cleared when the stamps wrap.
+struct SupersetMemo {
+    std::vector<Score> maxima;
+    std::vector<uint> stamps;
+    uint generation;
+    
+    SupersetMemo(): generation(0) {}
+    
+    inline void reset(size_t size) {
+        if(stamps.size() < size) {
+            maxima.resize(size);
+            stamps.resize(size, 0);
+        }
+        if(++generation == 0) {
+            stamps.assign(stamps.size(), 0);
+            generation = 1;
         }
-        return true;
     }
 };
 
@@ -48,26 +49,33 @@ class DomainBuilder {
 public:
     static uint get_depth(const Solution&, const ParentSet&);
     
-    DomainBuilder(Instance&, Solution&, ValueCalculator *, uint);
-    
-    bool in_same_subgraph(std::bitset<32>&, uint, uint);
+    DomainBuilder(Instance&, Solution&, MarkovBounder *, Score, uint,
+        OptionList&, std::vector<Score>&, SupersetMemo&);
     
-    Score build(uint, const std::bitset<32>&);
-    Score build_supersets(uint, std::bitset<32>);
+    Score build(uint, const VarSet&);
+    Score build_supersets(uint, VarSet);
 
     inline const OptionList& list() const {
         return option_list;
     }
     
+    inline const Fingerprint& key() const {
+        return fingerprint;
+    }
+    
     bool worsens_lexicographicality(uint, const ParentSet&);
     void construct_for(uint);
+    void sort();
 
 private:
     uint N, latest_var;
     Instance& instance;
     Solution& state;
     
-    std::unordered_map<std::bitset<32>, Score> superset_scores;
-    OptionList option_list;
-    ValueCalculator * calculate_ub;
-};
\ No newline at end of file
+    SupersetMemo& superset_scores;
+    OptionList& option_list;
+    Fingerprint fingerprint;
+    MarkovBounder * bounds;
+    Score lowerbound;
+    std::vector<Score>& child_bounds;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <ParentSet.hpp>
+#include <stdexcept>
+
+// Maps parent sets to their positions in a domain without hashing. Domains that
+// contain most small subsets are indexed directly by the combinatorial rank of the
+// subset; others are binary searched from a mask-sorted array.
+class DomainLookup {
+public:
+    static const size_t None = size_t(-1);
+    static const uint MaxRankedSize = 8;
+    
+    DomainLookup(): ranked(false) {}
+    
+    void build(const Domain&, uint, const uint32_t * order = nullptr);
+    
+    inline size_t find(const VarSet& subset) const {
+        if(!ranked)
+            return search(subset);
+        
+        size_t size = subset.count();
+        if(size + 1 >= offsets.size())
+            return None;
+        uint32_t pset = table[offsets[size] + rank(subset)];
+        return pset == uint32_t(-1)? None: pset;
+    }
+    
+    inline size_t at(const VarSet& subset) const {
+        size_t pset = find(subset);
+        if(pset == None)
+            throw std::out_of_range("DomainLookup::at");
+        return pset;
+    }
+    
+    inline bool contains(const VarSet& subset) const {
+        return find(subset) != None;
+    }
+    
+    size_t memory() const;
+
+protected:
+    inline size_t rank(const VarSet& subset) const {
+        size_t value = 0;
+        uint k = 0;
+        for(uint word = 0; word * 64 < VARIABLES; word++)
+            for(uint64_t bits = set_word(subset, word); bits; bits &= bits - 1)
+                value += binomial(word * 64 + __builtin_ctzll(bits), ++k);
+        return value;
+    }
+    
+    size_t search(const VarSet&) const;
+    
+    static size_t binomial(uint, uint);
+
+private:
+    bool ranked;
+    std::vector<uint32_t> table;
+    std::vector<size_t> offsets;
+    std::vector<std::pair<VarSet, uint32_t> > sorted;
+};
+
+bool mask_less(const VarSet&, const VarSet&);
+
+void initialize_lookup_table(std::vector<DomainLookup>&, const Domains&);
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <ParentSet.hpp>
+#include <string>
+
+struct GeneratorSettings {
+    uint variables, max_pset, arity;
+    double noise;
+    uint64_t seed;
+    
+    GeneratorSettings(): variables(12), max_pset(2), arity(2), noise(1), seed(1) {}
+};
+
+// Writes a score file in the Cussen format for a random chordal network. The
+// local scores are differences of a score over variable sets, as with BDeu or
+// BIC, so all orientations of a chordal network get the same total score.
+// Variable pairs that are adjacent in the ground truth add to the fit of the
+// sets that contain them, the parameters of a set are penalized by the arity
+// of the variables, and every set of two or more variables gets Gaussian noise.
+bool generate_scores(const std::string&, const GeneratorSettings&);
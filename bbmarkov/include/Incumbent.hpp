@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Solution.hpp>
+#include <atomic>
+#include <mutex>
+
+class Incumbent {
+public:
+    Incumbent(uint size, uint max_var):
+        value(-INF),
+        best(-INF, size, max_var) {}
+
+    inline Score score() const {
+        return value.load(std::memory_order_relaxed);
+    }
+
+    template<typename Callback>
+    bool offer(const Solution& candidate, Callback on_improvement) {
+        if(candidate.score <= score())
+            return false;
+
+        std::lock_guard<std::mutex> lock(guard);
+        if(candidate.score <= best.score)
+            return false;
+
+        best = candidate;
+        value.store(candidate.score, std::memory_order_release);
+        on_improvement();
+        return true;
+    }
+
+    inline bool offer(const Solution& candidate) {
+        return offer(candidate, []() {});
+    }
+
+    Solution solution() const {
+        std::lock_guard<std::mutex> lock(guard);
+        return best;
+    }
+
+private:
+    std::atomic<Score> value;
+    mutable std::mutex guard;
+    Solution best;
+};
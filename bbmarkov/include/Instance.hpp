@@ -2,24 +2,45 @@
 
 #include <ParentSet.hpp>
 #include <ScoreTree.hpp>
+#include <DomainLookup.hpp>
 #include <iostream>
 
 struct Instance {
     std::vector<Domain> domains;
     std::vector<DomainLookup> domain_lookup;
     std::vector<ScoreTree> score_tree;
-    size_t max_pset;
+    size_t max_pset, stride;
     
-    void init(std::istream&);
+    void init(std::istream&, size_t);
+    bool init(const std::string&, size_t);
+    void prepare(size_t);
+    
+    // Trees of an earlier instance whose tables are reused by prepare()
+    std::vector<ScoreTree> recycled;
+    size_t tree_memory() const;
+    size_t checksum() const;
     
     inline bool is_valid() const {
-        if(domains.size() == 0)
+        if(domains.size() == 0 || domains.size() > VARIABLES)
             return false;
-        for(size_t i = 1; i < domains.size(); i++)
-            if(domains[i].size() != domains[i - 1].size())
+        for(size_t i = 0; i < domains.size(); i++)
+            if(domains[i].empty())
                 return false;
         return true;
     }
     
-    Instance(const std::string&);
+    inline size_t option(uint var, size_t pset) const {
+        return pset + var * stride;
+    }
+    
+    inline uint option_var(size_t option) const {
+        return option / stride;
+    }
+    
+    inline size_t option_pset(size_t option) const {
+        return option % stride;
+    }
+    
+    Instance(const std::string&, size_t tree_budget = size_t(4096) << 20,
+        std::vector<ScoreTree> * recycled = nullptr);
 };
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Instance.hpp>
+#include <Incumbent.hpp>
+#include <Network.hpp>
+#include <atomic>
+#include <random>
+#include <thread>
+
+// Hill climbing over chordal structures (DAGs without immoralities) in a
+// background thread. Networks at local maxima are offered to the incumbent,
+// and the climb restarts from the incumbent with a few random moves, some of
+// which add arcs of the optimal Bayes network.
+class LocalSearch {
+public:
+    LocalSearch(Instance&, Incumbent&, const Network& bayes, uint);
+    ~LocalSearch();
+    
+    void start();
+    void stop();
+    
+    inline size_t improvements() const {
+        return published.load();
+    }
+    
+protected:
+    enum Kind {
+        Add, Remove, Reverse
+    };
+    
+    struct Move {
+        Score delta;
+        uint child, parent;
+        Kind kind;
+    };
+    
+    void run();
+    
+    Network from_incumbent() const;
+    Score local_score(uint, const VarSet&) const;
+    
+    void find_moves(const Network&, std::vector<Move>&);
+    void apply(Network&, const Move&);
+    bool climb(Network&);
+    void perturb(Network&, uint);
+    void publish(const Network&);
+    
+private:
+    Instance& instance;
+    Incumbent& incumbent;
+    ArcMatrix bayes;
+    uint N;
+    
+    ArcMatrix ancestors;
+    std::vector<Move> moves;
+    std::mt19937 random;
+    
+    std::thread thread;
+    std::atomic<bool> stopping;
+    std::atomic<size_t> published;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <debug.hpp>
+#include <string>
+
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+    
+    bool open(const std::string&);
+    bool create(const std::string&, size_t);
+    bool publish();
+    void close();
+    
+    inline char * data() const {
+        return address;
+    }
+    
+    inline size_t size() const {
+        return length;
+    }
+    
+    inline const std::string& path() const {
+        return name;
+    }
+    
+    double residency() const;
+    
+    static void page_faults(size_t&, size_t&);
+
+private:
+    MappedFile(const MappedFile&);
+    
+    char * address;
+    size_t length;
+    std::string name, temporary;
+};
@@ -3,43 +3,66 @@
 #include <ParentSet.hpp>
 #include <BayesSolver.hpp>
 #include <Moralizer.hpp>
+#include <TranspositionTable.hpp>
 #include <vector>
 
 class MarkovBounder {
 public:
-    typedef std::vector<std::bitset<32> > Cliques;
+    typedef std::vector<VarSet> Cliques;
     
-    MarkovBounder(const Solution&, Instance&, uint);
-
+    MarkovBounder(const Solution&, Instance&, const BayesSolver&, uint);
+    
+    // Both bounds are of the whole network, including state.score
     Score tight_upperbound(size_t, Score);
     
     inline Score fast_upperbound() {
         return state.score + bayes_solver.solve(state.assign_mask);
     }
     
-    Network lowerbound_solution(size_t);
+    // fast_upperbound() after assigning each unassigned variable in turn
+    inline void fast_child_upperbounds(std::vector<Score>& bounds) {
+        bayes_solver.solve_children(state.assign_mask, bounds);
+        for(uint var = 0; var < N; var++)
+            if(!state.assign_mask.test(var))
+                bounds[var] += state.score;
+    }
+    
+    Network lowerbound_solution(size_t, uint threads = 1);
     Network upperbound_solution();
     
     size_t best_final_parentset(uint) const;
     void construct_naive_cliques(Cliques&);
 
-    bool has_path_to(uint, uint, std::bitset<32>&, std::bitset<32>&);
+    inline bool has_path_to(uint source, uint target) const {
+        return state.ancestors[source].test(target);
+    }
+    
     void find_bad_cliques(uint, Cliques&);
     
     void construct_tight_cliques(Cliques&, const Cliques&, const Cliques&);
-    void decompose_clique(Cliques&, std::bitset<32>, const Cliques&,
-        size_t, std::unordered_set<std::bitset<32> >*);
+    void decompose_clique(Cliques&, VarSet, const Cliques&,
+        size_t, std::unordered_set<VarSet>*);
 
 protected:
-    size_t find_best_relaxedly_moral_parentset(const Cliques*, uint, const std::bitset<32>&);
-    size_t find_random_valid_parentset(const ArcMatrix&, uint, const std::bitset<32>&);
+    size_t find_best_relaxedly_moral_parentset(const Cliques*, uint, const VarSet&);
+    size_t find_random_valid_parentset(const ArcMatrix&, uint, const VarSet&);
     
-    Score upperbound(const Cliques*, std::bitset<32>, size_t, Score, Score);
+    Score upperbound(const Cliques*, VarSet, size_t, Score, Score);
     
 private:
     const Solution& state;
     Instance& instance;
-    BayesSolver bayes_solver;
+    const BayesSolver& bayes_solver;
     uint N;
-    std::unordered_map<std::bitset<32>, Score> seen;
+    std::vector<Cliques> cliques;
+    
+    // Bounds computed during the current call of tight_upperbound(), told apart
+    // from older ones by their generation.
+    struct Seen {
+        VarSet assigned;
+        Score value;
+        uint generation;
+    };
+    std::vector<Seen> seen;
+    uint generation;
 };
\ No newline at end of file
@@ -5,8 +5,7 @@
 #include <ParentSet.hpp>
 #include <Network.hpp>
 #include <unordered_set>
-#include <unordered_map>
-#include <queue>
+#include <vector>
 
 class Moralizer {
 public:
@@ -14,30 +13,59 @@ public:
         AddEdges, RemoveEdges
     };
     
-    typedef std::priority_queue<Network> Queue;
+    // A candidate network, stored as the arc it toggles and the score after the toggle.
+    // It's only built when the search expands it.
+    struct Edit {
+        Score score;
+        uint child, parent;
+        
+        inline bool operator<(const Edit& other) const {
+            if(score != other.score)
+                return score > other.score;
+            return child != other.child? child < other.child: parent < other.parent;
+        }
+    };
     
-    Moralizer(Instance&, uint);
+    typedef std::vector<Edit> Edits;
     
-    size_t count_immoralities(const ArcMatrix&);
+    Moralizer(Instance&, uint, uint threads = 1);
     
-    Network moralize(const ArcMatrix&, Direction, size_t);
+    Network moralize(const ArcMatrix&, Direction, size_t, uint);
     Network moralize(const ArcMatrix&, size_t);
     
 protected:
-    std::bitset<32> parentset_of(const ArcMatrix&, uint);
+    struct Search {
+        Direction direction;
+        size_t accuracy;
+        std::unordered_set<uint64_t> visited;
+        std::vector<ArcMatrix> closures;
+        Network best;
+        
+        Search(Direction d, size_t a):
+            direction(d),
+            accuracy(a),
+            best(ArcMatrix(), -INF) {}
+    };
+    
+    static inline uint64_t arc_key(uint child, uint parent) {
+        return mix64(uint64_t(child) * VARIABLES + parent + 1);
+    }
+    
+    VarSet parentset_of(const ArcMatrix&, uint);
+    Score local_score(const ArcMatrix&, uint);
     
-    void fix_global_immoralities(const Network&, Network&,
-        Direction, size_t, size_t);
+    void add_to_closure(ArcMatrix&, uint, uint);
     
-    void clear_candidates(Queue&, size_t);
+    void fix_global_immoralities(Search&, Network&, uint64_t, size_t);
+    void expand(Search&, Network&, uint64_t, size_t, const Edit&);
+    void select_candidates(Edits&, size_t);
     
-    void consider_edge_addition(Queue&, Network, uint, uint);
-    void consider_edge_removal(Queue&, Network, uint, uint);
+    void consider_edge_addition(Edits&, Network&, const ArcMatrix&, uint, uint);
+    void consider_edge_removal(Edits&, Network&, uint, uint);
     
-    size_t find_immoralities(Queue&, const Network&, Direction);
+    size_t find_immoralities(Edits&, Network&, const ArcMatrix&, Direction);
 
 private:
     Instance& instance;
-    NetworkSet visited;
-    uint max_var;
+    uint max_var, threads;
 };
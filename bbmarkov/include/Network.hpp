@@ -1,9 +1,9 @@
 #pragma once
 
 #include <ParentSet.hpp>
-#include <unordered_set>
+#include <string>
 
-typedef std::vector<std::bitset<32> > ArcMatrix;
+typedef std::vector<VarSet> ArcMatrix;
 
 struct Network {
     ArcMatrix matrix;
@@ -15,22 +15,15 @@ struct Network {
     Network(Network&& n): matrix(std::move(n.matrix)), score(n.score) {}
     Network(const Network& n): matrix(n.matrix), score(n.score) {}
     
-    Network& operator=(Network&& n) { matrix.swap(n.matrix); score = n.score; }
-    Network& operator=(const Network& n) { matrix = n.matrix; score = n.score; }
+    Network& operator=(Network&& n) { matrix.swap(n.matrix); score = n.score; return * this; }
+    Network& operator=(const Network& n) { matrix = n.matrix; score = n.score; return * this; }
     
     bool operator<(const Network&) const;
     size_t count_immoralities() const;
-    
-    bool has_path_between(uint, uint, std::bitset<32>&);
-    bool is_within_cycle(uint);
-};
-
-struct NetworkHash {
-    size_t operator()(const ArcMatrix&) const;
 };
 
-struct NetworkCompare {
-    bool operator()(const ArcMatrix&, const ArcMatrix&) const;
-};
+ArcMatrix transitive_closure(const ArcMatrix&);
+size_t find_immoral_pairs(const ArcMatrix&, ArcMatrix&);
 
-typedef std::unordered_set<ArcMatrix, NetworkHash, NetworkCompare> NetworkSet;
\ No newline at end of file
+bool read_undirected_network(const std::string&, uint, ArcMatrix&, std::string&);
+bool perfect_ordering(const ArcMatrix&, uint, std::vector<uint>&);
\ No newline at end of file
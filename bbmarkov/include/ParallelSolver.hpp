@@ -0,0 +1,26 @@
+#pragma once
+
+#include <Solver.hpp>
+#include <Incumbent.hpp>
+#include <TaskPool.hpp>
+#include <memory>
+
+class ParallelSolver {
+public:
+    ParallelSolver(const Settings&, Instance&, uint);
+    
+    void solve();
+    const Solution& solution() const;
+
+protected:
+    void work(uint);
+
+private:
+    uint N;
+    Settings settings;
+    Instance& instance;
+    
+    SearchContext context;
+    TaskPool pool;
+    std::vector<std::unique_ptr<Solver> > workers;
+};
@@ -6,14 +6,26 @@
 #include <fstream>
 #include <unordered_map>
 #include <bitset>
+#include <cstdint>
 #include <debug.hpp>
 
 typedef double Score;
 
 #define INF 9999999
 
+// The widest supported instance; std::bitset<32> and std::bitset<64> both take
+// a single machine word, so only wider builds (make VARIABLES=128) cost anything.
+#ifndef VARIABLES
+    #define VARIABLES 64
+#endif
+
+typedef std::bitset<VARIABLES> VarSet;
+
+// Dense tables indexed by subsets are only built for instances this small
+#define MAX_DENSE_VARIABLES 32
+
 struct ParentSet {
-    std::bitset<32> content;
+    VarSet content;
     std::vector<uint> list;
     Score score;
 
@@ -33,16 +45,22 @@ struct ParentSet {
     }
 };
 
-inline std::bitset<32> full_set(uint N) {
-    return std::bitset<32>((size_t(1) << N) - 1);
+inline uint64_t set_word(const VarSet& set, uint word) {
+    return ((set >> (word * 64)) & VarSet(~0ull)).to_ullong();
+}
+
+inline void add_word(VarSet& set, uint word, uint64_t bits) {
+    set |= VarSet(bits) << (word * 64);
+}
+
+inline VarSet full_set(uint N) {
+    return N? ~VarSet() >> (VARIABLES - N): VarSet();
 }
 
 typedef std::vector<ParentSet> Domain;
 typedef std::vector<Domain> Domains;
-typedef std::unordered_map<std::bitset<32>, size_t> DomainLookup;
 
 std::ostream& operator<<(std::ostream&, const ParentSet&);
 
-void initialize_lookup_table(std::vector<DomainLookup>&, const Domains&);
 
 void read_cussen_scores(std::istream&, Domains&);
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <debug.hpp>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Time spent in the main parts of the search and the reasons branches are
+// closed, collected with --profile.
+struct Profile {
+    enum Section {
+        FastUpperbounds, TightUpperbounds, OptionLists, MemoLookups, Moralizer,
+        Sections
+    };
+    
+    enum Prune {
+        AtBottom, Upperbound, TightUpperbound, OptionCache, RaisedLowerbound,
+        Prunes
+    };
+    
+    static const char * section_names[Sections];
+    static const char * prune_names[Prunes];
+    static const uint Buckets = 33;
+    
+    bool enabled;
+    uint64_t nanoseconds[Sections], calls[Sections];
+    std::vector<size_t> prunes;
+    size_t list_sizes[Buckets];
+    
+    Profile(uint layers = 0);
+    
+    inline void prune(uint layer, Prune reason) {
+        prunes[layer * Prunes + reason]++;
+    }
+    
+    // Option lists are counted in buckets of [2^(b - 1), 2^b)
+    inline void option_list(size_t size) {
+        list_sizes[size? 64 - __builtin_clzll(size): 0]++;
+    }
+    
+    void merge(const Profile&);
+    
+    static inline uint64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+
+class ProfileTimer {
+public:
+    ProfileTimer(Profile& p, Profile::Section s):
+        profile(p),
+        section(s),
+        start(p.enabled? Profile::now(): 0) {}
+    
+    ~ProfileTimer() {
+        if(profile.enabled) {
+            profile.nanoseconds[section] += Profile::now() - start;
+            profile.calls[section]++;
+        }
+    }
+
+private:
+    Profile& profile;
+    Profile::Section section;
+    uint64_t start;
+};
+
+// The resident memory of the process in bytes, or 0 where it can't be read
+size_t resident_memory();
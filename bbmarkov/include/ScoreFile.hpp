@@ -0,0 +1,9 @@
+#pragma once
+
+#include <ParentSet.hpp>
+#include <MappedFile.hpp>
+#include <DomainLookup.hpp>
+
+bool is_binary_scores(const MappedFile&);
+bool read_binary_scores(const MappedFile&, Domains&, std::vector<DomainLookup>&);
+bool write_binary_scores(const std::string&, const Domains&);
@@ -1,25 +1,61 @@
 #pragma once
 
 #include <ParentSet.hpp>
+#include <atomic>
+#include <cstdint>
 
 class ScoreTree {
 public:
-    ScoreTree(uint);
+    enum Mode {
+        Narrow, Wide, Sparse
+    };
+    
+    static Mode choose_mode(uint, size_t, size_t);
+    
+    ScoreTree(uint, Mode);
 
-    void construct(const Domain&, const DomainLookup&);
-    size_t construct(std::bitset<32>);
+    void reset(uint, Mode);
+    void construct(const Domain&);
     
-    inline size_t get(const std::bitset<32>& subset) const {
-        return sequences[subset.to_ulong()];
+    inline size_t get(const VarSet& subset) const {
+        switch(mode) {
+            case Narrow: return narrow[subset.to_ulong()];
+            case Wide: return wide[subset.to_ulong()];
+            default: return find(subset);
+        }
     }
 
-    const ParentSet& best_within(const std::bitset<32>& subset) const {
-        return (* domain)[sequences[subset.to_ulong()]];
+    const ParentSet& best_within(const VarSet& subset) const {
+        return (* domain)[get(subset)];
     }
+    
+    inline Mode representation() const {
+        return mode;
+    }
+    
+    size_t memory() const;
+
+protected:
+    size_t find(const VarSet&) const;
+    size_t scan(const VarSet&) const;
 
 private:
+    static const size_t CacheSize = 1 << 14;
+    
+    struct CacheEntry {
+        uint64_t tree;
+        VarSet subset;
+        uint32_t pset;
+    };
+    
+    static thread_local CacheEntry cache[CacheSize];
+    static std::atomic<uint64_t> trees;
+    
     uint N;
+    uint64_t id;
+    Mode mode;
     const Domain* domain;
-    const DomainLookup* domain_lookup;
-    std::vector<size_t> sequences;
+    std::vector<uint16_t> narrow;
+    std::vector<uint32_t> wide;
+    std::vector<VarSet> masks;
 };
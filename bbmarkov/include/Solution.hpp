@@ -2,23 +2,42 @@
 
 #include <ParentSet.hpp>
 #include <Network.hpp>
+#include <DomainLookup.hpp>
+#include <TranspositionTable.hpp>
 #include <vector>
 #include <bitset>
+#include <utility>
 
 struct Vertex {
     uint depth, parentset;
 };
 
+// Zobrist key of the skeleton cell (a, b); the cell (v, v) marks v as assigned. The
+// hash covers the assigned vertices and the undirected edges, not their directions.
+inline uint64_t skeleton_key(uint a, uint b) {
+    if(a > b)
+        std::swap(a, b);
+    return mix64(uint64_t(a) * VARIABLES + b + 1);
+}
+
 struct Solution {
     Score score;
+    uint64_t hash;
     std::vector<Vertex> vertexes;
     ArcMatrix skeleton;
-    std::bitset<32> assign_mask;
+    VarSet assign_mask;
+    
+    // The ancestors of each assigned vertex, including the vertex itself. Parents
+    // are assigned before their children, so set_parents() only has to join the
+    // ancestors of the parents.
+    std::vector<VarSet> ancestors;
     
     Solution(Score s, uint size, uint max_var):
         score(s),
+        hash(0),
         vertexes(size, Vertex {max_var, 0}),
-        skeleton(size, std::bitset<32>(0)) {}
+        skeleton(size, VarSet(0)),
+        ancestors(size, VarSet(0)) {}
 
     inline bool contains(uint var) const {
         return assign_mask.test(var);
@@ -40,6 +59,13 @@ struct Solution {
     void set_parents(uint, const ParentSet&);
     void reset_parents(uint);
     
+    inline VarSet ancestors_of(const ParentSet& parents) const {
+        VarSet set;
+        for(uint parent: parents.list)
+            set |= ancestors[parent];
+        return set;
+    }
+    
     std::string fingerprint() const;
 };
 
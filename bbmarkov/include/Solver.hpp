@@ -4,23 +4,47 @@
 #include <DomainBuilder.hpp>
 #include <MarkovBounder.hpp>
 #include <Network.hpp>
+#include <Incumbent.hpp>
+#include <TaskPool.hpp>
+#include <Allocations.hpp>
+#include <LocalSearch.hpp>
+#include <Checkpoint.hpp>
+#include <Profile.hpp>
+#include <Generator.hpp>
 #include <unordered_set>
 #include <unordered_map>
 #include <fstream>
+#include <memory>
 
 struct Statistics {
     std::vector<size_t> layer_visits;
     size_t start_time;
-    size_t skeleton_hits, option_hits;
-    size_t tight_UBs, successful_tight_UBs;
+    size_t recurring_skeletons, option_hits;
+    size_t tight_UBs, successful_tight_UBs, bayes_time;
     Score LB, UB;
+    size_t merged_skeletons, merged_option_lists;
+    size_t minor_faults, major_faults;
+    size_t allocations, local_improvements;
+    TranspositionTable::Counters merged_memo;
+    std::vector<size_t> layer_expansions;
+    size_t depth_first_subtrees, frontier_peak;
+    Profile profile;
     
     inline size_t time() const {
         return get_time() - start_time;
     }
+    
+    inline size_t visits() const {
+        size_t total = 0;
+        for(size_t visits: layer_visits)
+            total += visits;
+        return total;
+    }
+    
+    void merge(const Statistics&);
 };
 
-static const std::string& flag_symbols = "vVsoftu";
+static const std::string& flag_symbols = "vVsoftulbc";
 
 enum Flag {
     MinVerbosity,
@@ -29,43 +53,151 @@ enum Flag {
     MemoizeOptions,
     FixedSourceVertex,
     TightUpperbounds,
-    SortByUpperbounds
+    SortByUpperbounds,
+    ImproveIncumbent,
+    BestFirst,
+    CliqueTrees
+};
+
+// A partial solution waiting in the best-first frontier, identified by the
+// options assigned after the root.
+struct FrontierNode {
+    Score bound;
+    std::vector<size_t> path;
+    
+    inline bool operator<(const FrontierNode& other) const {
+        return bound < other.bound;
+    }
+    
+    inline size_t memory() const {
+        return sizeof(FrontierNode) + path.capacity() * sizeof(size_t);
+    }
 };
 
+struct SearchContext {
+    Incumbent incumbent;
+    BayesSolver bayes_solver;
+    std::atomic<size_t> visits;
+    
+    SearchContext(Instance& instance, uint max_var):
+        incumbent(instance.domains.size(), max_var),
+        bayes_solver(instance, max_var),
+        visits(0) {}
+};
+
+struct Settings {
+    std::bitset<32> flags;
+    uint threads, split_depth;
+    size_t tree_mb, bayes_mb, memo_mb, frontier_mb, dp_mb, checkpoint_s, progress_ms;
+    std::string input, bayes_file, convert, batch, checkpoint, resume, initial;
+    std::string generate, benchmark, flag_sets;
+    GeneratorSettings generator;
+    bool silent, profile;
+    
+    Settings(): threads(1), split_depth(2), tree_mb(4096), bayes_mb(16384), memo_mb(256),
+        frontier_mb(1024), dp_mb(4096), checkpoint_s(600), progress_ms(0), flag_sets("ft,fto,ftu,fo,fu,ftuo"),
+        silent(false), profile(false) {}
+};
+
+std::string formatted_time(size_t);
+
 class Solver {
 public:
-    Solver(const std::bitset<32>&, Instance&, uint);
+    Solver(const Settings&, Instance&, uint, SearchContext * shared = nullptr,
+        TranspositionTable * memo = nullptr);
     
     void solve();
     const Solution& solution() const;
+    
+    inline const Statistics& statistics() const {
+        return stats;
+    }
+    
+    // Hands the table of option lists (-o) back for the next solver to reuse
+    inline void swap_memo(TranspositionTable& memo) {
+        option_memo.swap(memo);
+    }
+    
+    double option_hit_rate() const;
+    double skeleton_recurrence_rate() const;
+    
+    bool initialize();
+    void finish();
+    
+    void fix_source_vertex();
+    void attach(TaskPool *, uint);
+    void run(const Task&);
+    void merge_statistics(const Solver&);
 
 protected:
     void output_lowerbound(const std::string& title);
     void output_statistics();
-    void track_skeletons();
+    
+    inline Score lowerbound() const {
+        return incumbent.score();
+    }
+    
+    inline Score fast_upperbound() {
+        ProfileTimer timer(stats.profile, Profile::FastUpperbounds);
+        return bounds.fast_upperbound();
+    }
+    
+    inline Score tight_upperbound() {
+        ProfileTimer timer(stats.profile, Profile::TightUpperbounds);
+        return bounds.tight_upperbound(10, lowerbound());
+    }
+    
+    bool tight_bound_pays_off(uint) const;
+    
+    void assign(size_t);
+    void unassign(size_t, Score);
+    void split(const OptionList&);
     
     Score generate_lowerbound();
+    void offer_initial_network();
     Score choose_last_parentset();
-    Score solve(uint, size_t edges = 0);
+    Score solve(uint);
+    
+    void best_first();
+    void expand(uint, std::vector<FrontierNode>&, size_t&);
+    
+    void poll();
+    void output_progress();
+    void output_profile();
+    void save_checkpoint();
+    void restore_checkpoint();
 
 private:
     uint N;
+    Settings settings;
     std::bitset<32> flags;
     Statistics stats;
     Instance& instance;
     
+    std::unique_ptr<SearchContext> own_context;
+    SearchContext& context;
+    Incumbent& incumbent;
+    BayesSolver& bayes_solver;
+    
+    TaskPool * pool;
+    uint worker, root_order;
+    std::vector<size_t> path;
+    
+    // The option index taken at each depth of the current path, and the indices
+    // still to be replayed from a checkpoint
+    std::vector<size_t> positions, resume_positions, resume_options;
+    size_t poll_countdown, next_checkpoint, next_progress;
+    size_t reported_visits, progress_visits, progress_time;
+    Score global_ub;
+    
     Solution state;
-    std::unordered_map<
-        ArcMatrix,
-        Solution,
-        NetworkHash,
-        NetworkCompare> skeleton_memo;
-    std::unordered_map<
-        OptionList,
-        Score,
-        OptionsHash,
-        OptionsCompare> option_memo;
+    SkeletonTable skeleton_memo;
+    TranspositionTable option_memo;
+    std::vector<OptionList> option_buffers;
+    std::vector<std::vector<Score> > bound_buffers;
+    SupersetMemo superset_scores;
     MarkovBounder bounds;
+    std::unique_ptr<LocalSearch> improver;
     
 public:
     Solution lb_solution;
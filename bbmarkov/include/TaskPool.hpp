@@ -0,0 +1,46 @@
+#pragma once
+
+#include <debug.hpp>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+struct Task {
+    std::vector<size_t> path;
+};
+
+class TaskPool {
+public:
+    TaskPool(uint);
+
+    void push(uint, Task&&);
+    bool take(uint, Task&);
+    void finish();
+
+    inline uint workers() const {
+        return queues.size();
+    }
+
+protected:
+    bool take_own(uint, Task&);
+    bool steal(uint, Task&);
+
+private:
+    struct Queue {
+        std::mutex guard;
+        std::deque<Task> tasks;
+    };
+
+    void signal(bool);
+
+    std::vector<std::unique_ptr<Queue> > queues;
+    std::atomic<size_t> pending;
+    
+    // Idle workers sleep until a task is pushed or the last one is finished
+    std::mutex idle_guard;
+    std::condition_variable idle;
+    size_t version;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <ParentSet.hpp>
+#include <vector>
+#include <cstdint>
+#include <initializer_list>
+#include <utility>
+
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// A 128-bit fingerprint of an unordered collection. Adding the same values in any
+// order gives the same fingerprint.
+struct Fingerprint {
+    uint64_t low, high;
+    
+    Fingerprint(): low(0), high(0) {}
+    
+    inline void add(uint64_t value) {
+        low += mix64(value);
+        high += mix64(value ^ 0x9e3779b97f4a7c15ULL);
+    }
+    
+    inline bool operator==(const Fingerprint& other) const {
+        return low == other.low && high == other.high;
+    }
+};
+
+// A fixed-size table of scores keyed by fingerprints. Each bucket keeps the entry of
+// the largest subtree seen so far and the most recent other entry, so deep searches
+// cannot flush the valuable entries near the root. Entries written before the latest
+// clear() are recognized by their generation and treated as empty.
+class TranspositionTable {
+public:
+    struct Counters {
+        size_t lookups, matches, collisions, evictions;
+        
+        void merge(const Counters&);
+    };
+    
+    TranspositionTable();
+    
+    void allocate(size_t);
+    void clear();
+    bool find(const Fingerprint&, Score&);
+    void store(const Fingerprint&, uint, Score);
+    
+    inline void swap(TranspositionTable& other) {
+        std::swap(* this, other);
+    }
+    
+    inline bool is_allocated() const {
+        return !buckets.empty();
+    }
+    
+    inline const Counters& counters() const {
+        return count;
+    }
+    
+    inline size_t size() const {
+        return used;
+    }
+    
+    inline size_t memory() const {
+        return buckets.size() * sizeof(Bucket);
+    }
+
+private:
+    struct Entry {
+        Fingerprint key;
+        Score value;
+        uint32_t depth, generation;
+    };
+    
+    struct Bucket {
+        Entry deep, recent;
+    };
+    
+    inline Bucket& bucket(const Fingerprint& key) {
+        return buckets[key.low & (buckets.size() - 1)];
+    }
+    
+    inline bool is_empty(const Entry& entry) const {
+        return entry.generation != generation;
+    }
+    
+    void replace(Entry&, const Entry&);
+    
+    std::vector<Bucket> buckets;
+    Counters count;
+    size_t used;
+    uint32_t generation;
+};
+
+// A direct-mapped set of the Zobrist hashes of recently reached skeletons. The
+// search rules reach each skeleton once, so -s only counts recurrences with it.
+class SkeletonTable {
+public:
+    SkeletonTable(): checked(0) {}
+    
+    void allocate(size_t);
+    bool recurs(uint64_t);
+    
+    inline size_t size() const {
+        return checked;
+    }
+
+private:
+    std::vector<uint64_t> hashes;
+    size_t checked;
+};
@@ -0,0 +1,44 @@
+#include <Allocations.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<size_t> allocations(0);
+
+size_t allocation_count() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+// Like the standard operator new, calls the new handler until the allocation
+// succeeds and only throws when there is no handler.
+void * operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    while(true) {
+        if(void * memory = std::malloc(size ? size : 1))
+            return memory;
+        std::new_handler handler = std::get_new_handler();
+        if(!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+void * operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void * memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void * memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void * memory, size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void * memory, size_t) noexcept {
+    std::free(memory);
+}
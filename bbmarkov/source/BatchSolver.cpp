@@ -0,0 +1,96 @@
+#include <BatchSolver.hpp>
+#include <CliqueTreeSolver.hpp>
+#include <thread>
+
+BatchSolver::BatchSolver(const Settings& s):
+    settings(s),
+    workers(s.threads),
+    next(0) {
+    
+    settings.threads = 1;
+    settings.silent = true;
+    settings.flags[MinVerbosity] = true;
+    settings.flags[MaxVerbosity] = false;
+}
+
+bool read_manifest(const std::string& fname, std::vector<std::string>& files) {
+    std::ifstream manifest(fname);
+    if(!manifest.is_open())
+        return false;
+    
+    std::string line;
+    while(std::getline(manifest, line)) {
+        while(!line.empty() && (line.back() == '\r' || line.back() == ' '))
+            line.pop_back();
+        if(!line.empty() && line[0] != '#')
+            files.push_back(line);
+    }
+    return true;
+}
+
+bool BatchSolver::read_manifest(const std::string& fname) {
+    return ::read_manifest(fname, files);
+}
+
+void BatchSolver::output(const std::string& line) {
+    std::lock_guard<std::mutex> lock(guard);
+    std::cout << line << std::endl;
+}
+
+void BatchSolver::solve(const std::string& fname, std::vector<ScoreTree>& trees,
+        std::vector<Score>& table, TranspositionTable& memo) {
+    
+    size_t start = get_time();
+    Instance instance(fname, settings.tree_mb << 20, &trees);
+    if(!instance.is_valid()) {
+        output(format("%\tinvalid", fname));
+        instance.recycled.swap(trees);
+        return;
+    }
+    
+    std::string reason;
+    CliqueTreeSolver dp(settings, instance);
+    if(settings.flags[CliqueTrees] && dp.prepare(reason)) {
+        dp.solve();
+        output(format("%\t%\t%\t%\t%", fname, to_string(dp.solution().score),
+            get_time() - start, dp.states(), dp.solution().fingerprint()));
+        instance.score_tree.swap(trees);
+        return;
+    }
+    
+    uint N = instance.domains.size();
+    SearchContext context(instance, N);
+    context.bayes_solver.swap_table(table);
+    {
+        Solver solver(settings, instance, N, &context, &memo);
+        solver.solve();
+        
+        output(format("%\t%\t%\t%\t%", fname, to_string(solver.solution().score),
+            get_time() - start, solver.statistics().visits(),
+            solver.solution().fingerprint()));
+        solver.swap_memo(memo);
+    }
+    context.bayes_solver.swap_table(table);
+    instance.score_tree.swap(trees);
+}
+
+void BatchSolver::work() {
+    std::vector<ScoreTree> trees;
+    std::vector<Score> table;
+    TranspositionTable memo;
+    
+    for(size_t i = next++; i < files.size(); i = next++)
+        solve(files[i], trees, table, memo);
+}
+
+void BatchSolver::solve() {
+    output("file\tscore\ttime_ms\tnodes\tfingerprint");
+    
+    std::vector<std::thread> threads;
+    for(uint w = 1; w < std::min<size_t>(workers, files.size()); w++)
+        threads.push_back(std::thread(&BatchSolver::work, this));
+    work();
+    
+    for(std::thread& thread: threads)
+        thread.join();
+}
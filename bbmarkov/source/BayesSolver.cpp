@@ -1,38 +1,185 @@
 #include <BayesSolver.hpp>
 #include <debug.hpp>
 #include <algorithm>
+#include <thread>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+
+struct TableHeader {
+    char magic[8];
+    uint64_t variables, checksum, complete;
+};
+
+static const char * table_magic = "BBMBAYES";
 
 BayesSolver::BayesSolver(Instance& i, uint mv):
-    instance(i), N(mv) {
-    scores.insert(scores.begin(), size_t(1) << N, -INF);
-    scores[full_set(N).to_ulong()] = 0;
+    instance(i), N(mv), table(nullptr), reused(false) {
+    
+    for(uint n = 0; n <= 32; n++)
+        for(uint k = 0; k <= 32; k++)
+            binomials[n][k] = k > n? 0: k == 0 || k == n? 1:
+                binomials[n - 1][k - 1] + binomials[n - 1][k];
+    
+    offsets[0] = 0;
+    for(uint k = 0; k <= N && N <= MAX_DENSE_VARIABLES; k++)
+        offsets[k + 1] = offsets[k] + binomials[N][k];
+    
+    for(uint var = 0; var < N; var++)
+        best_scores.push_back(instance.domains[var][0].score);
+}
+
+bool BayesSolver::fits(size_t budget, size_t width) const {
+    return N <= MAX_DENSE_VARIABLES && (size_t(1) << N) * width <= budget;
+}
+
+Score BayesSolver::relaxed(const VarSet& assigned) const {
+    Score value = 0;
+    for(uint var = 0; var < N; var++)
+        if(!assigned.test(var))
+            value += best_scores[var];
+    return value;
+}
+
+// The bounds after assigning each unassigned variable, in one pass over them.
+// Without a table, every bound is the relaxed one minus a single term.
+void BayesSolver::solve_children(const VarSet& assigned, std::vector<Score>& bounds) const {
+    bounds.resize(N);
+    if(!is_filled()) {
+        Score value = relaxed(assigned);
+        for(uint var = 0; var < N; var++)
+            if(!assigned.test(var))
+                bounds[var] = value - best_scores[var];
+        return;
+    }
+    
+    size_t subset = assigned.to_ulong();
+    for(uint var = 0; var < N; var++)
+        if(!assigned.test(var))
+            bounds[var] = value(subset | size_t(1) << var);
 }
 
-size_t BayesSolver::find_best_parentset(uint var, const std::bitset<32>& assigned) const {
+size_t BayesSolver::find_best_parentset(uint var, const VarSet& assigned) const {
     return instance.score_tree[var].get(assigned);
 }
 
-Score BayesSolver::solve(std::bitset<32> assigned) {
+size_t unrank_subset(uint n, uint k, size_t rank, const size_t binomials[33][33]) {
+    size_t subset = 0;
+    for(uint i = n; i-- > 0 && k > 0;) {
+        size_t count = binomials[i][k];
+        if(count <= rank) {
+            subset |= size_t(1) << i;
+            rank -= count;
+            k--;
+        }
+    }
+    return subset;
+}
+
+inline size_t next_subset(size_t subset) {
+    size_t lowest = subset & -subset;
+    size_t ripple = subset + lowest;
+    return (((ripple ^ subset) >> 2) / lowest) | ripple;
+}
 
-    Score& value = scores[assigned.to_ulong()];
-    if(value != -INF)
-        return value;
+Score BayesSolver::evaluate(size_t assigned) const {
+    Score candidates[32];
+    uint count = 0;
 
     for(uint var = 0; var < N; var++) {
-        if(assigned[var]) continue;
+        if(assigned & (size_t(1) << var))
+            continue;
+        candidates[count++] = value(assigned | (size_t(1) << var)) +
+            instance.score_tree[var].best_within(assigned).score;
+    }
+    
+    Score value = -INF;
+    for(uint i = 0; i < count; i++)
+        value = candidates[i] > value? candidates[i]: value;
+    return value;
+}
+
+void BayesSolver::store(uint layer, size_t rank, size_t subset, Score score) {
+    if(!table) {
+        scores[subset] = score;
+        return;
+    }
+    
+    // Rounded upwards so that the stored values remain upper bounds
+    float rounded = score;
+    if(rounded < score)
+        rounded = std::nextafter(rounded, float(INF));
+    table[offsets[layer] + rank] = rounded;
+}
+
+void BayesSolver::fill_layer(uint layer, size_t begin, size_t end) {
+    size_t subset = unrank_subset(N, layer, begin, binomials);
+    for(size_t i = begin; i < end; i++) {
+        store(layer, i, subset, evaluate(subset));
+        if(layer > 0)
+            subset = next_subset(subset);
+    }
+}
+
+void BayesSolver::fill_layers(uint threads) {
+    store(N, 0, full_set(N).to_ulong(), 0);
+
+    for(uint layer = N; layer-- > 0;) {
+        size_t size = binomials[N][layer];
+        size_t workers = std::min<size_t>(threads, size / 1024 + 1);
         
-        assigned[var] = true;
-        Score score = solve(assigned);
-        assigned[var] = false;
+        std::vector<std::thread> pool;
+        for(size_t w = 1; w < workers; w++)
+            pool.push_back(std::thread(&BayesSolver::fill_layer, this,
+                layer, size * w / workers, size * (w + 1) / workers));
+        fill_layer(layer, 0, size / workers);
         
-        score += instance.score_tree[var].best_within(assigned).score;
-        if(value < score)
-            value = score;
+        for(std::thread& thread: pool)
+            thread.join();
     }
-    return value;
 }
 
-uint BayesSolver::find_best_variable(std::bitset<32> assigned) const {
+bool BayesSolver::fill(uint threads, size_t budget) {
+    if(!fits(budget, sizeof(Score)))
+        return false;
+    scores.assign(size_t(1) << N, -INF);
+    fill_layers(threads);
+    return true;
+}
+
+bool BayesSolver::fill(uint threads, size_t budget, const std::string& fname) {
+    if(!fits(budget, sizeof(float)))
+        return false;
+    
+    size_t bytes = sizeof(TableHeader) + offsets[N + 1] * sizeof(float);
+    size_t hash = instance.checksum();
+    
+    if(file.open(fname) && file.size() == bytes) {
+        const TableHeader& header = * (const TableHeader *) file.data();
+        if(!std::memcmp(header.magic, table_magic, 8) && header.variables == N &&
+                header.checksum == hash && header.complete) {
+            table = (float *) (file.data() + sizeof(TableHeader));
+            reused = true;
+            return true;
+        }
+    }
+    
+    if(!file.create(fname, bytes))
+        return fill(threads, budget);
+    
+    table = (float *) (file.data() + sizeof(TableHeader));
+    fill_layers(threads);
+    
+    TableHeader& header = * (TableHeader *) file.data();
+    std::memcpy(header.magic, table_magic, 8);
+    header.variables = N;
+    header.checksum = hash;
+    header.complete = 1;
+    file.publish();
+    return true;
+}
+
+uint BayesSolver::find_best_variable(VarSet assigned) const {
     uint best_var = 0;
     Score best_score = -INF;
     for(uint var = 0; var < N; var++) {
@@ -40,7 +187,7 @@ uint BayesSolver::find_best_variable(std::bitset<32> assigned) const {
         assigned[var] = true;
 
         size_t pset = find_best_parentset(var, assigned);
-        Score score = scores[assigned.to_ulong()] + instance.domains[var][pset].score;
+        Score score = solve(assigned) + instance.domains[var][pset].score;
         if(score > best_score) {
             best_var = var;
             best_score = score;
@@ -50,7 +197,7 @@ uint BayesSolver::find_best_variable(std::bitset<32> assigned) const {
     return best_var;
 }
 
-void BayesSolver::assign_next_variable(ArcMatrix& matrix, std::bitset<32>& assigned) const {
+void BayesSolver::assign_next_variable(ArcMatrix& matrix, VarSet& assigned) const {
     
     uint var = find_best_variable(assigned);
     size_t pset = find_best_parentset(var, assigned);
@@ -61,8 +208,8 @@ void BayesSolver::assign_next_variable(ArcMatrix& matrix, std::bitset<32>& assig
     assigned[var] = true;
 }
 
-void BayesSolver::construct_solution(ArcMatrix& matrix, std::bitset<32> assigned) const {
-    assert(scores[assigned.to_ulong()] != -INF);
+void BayesSolver::construct_solution(ArcMatrix& matrix, VarSet assigned) const {
+    assert(solve(assigned) != -INF);
 
     while(assigned.count() < N)
         assign_next_variable(matrix, assigned);
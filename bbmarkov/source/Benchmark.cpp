@@ -0,0 +1,95 @@
+#include <Benchmark.hpp>
+#include <BatchSolver.hpp>
+#include <CliqueTreeSolver.hpp>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+Benchmark::Benchmark(const Settings& s, const std::string& sets):
+    settings(s) {
+    
+    settings.silent = true;
+    std::string set;
+    for(char c: sets + ",") {
+        if(c != ',') {
+            set += c;
+            continue;
+        }
+        if(!set.empty())
+            flag_sets.push_back(set);
+        set.clear();
+    }
+}
+
+bool Benchmark::read_manifest(const std::string& fname) {
+    return ::read_manifest(fname, files);
+}
+
+void Benchmark::run(const std::string& fname, const std::string& flag_set) {
+    Settings run_settings = settings;
+    run_settings.flags.reset();
+    for(char symbol: flag_set) {
+        size_t flag = flag_symbols.find(symbol);
+        if(flag == std::string::npos) {
+            print("%,%,invalid flags,,,,,,\n", fname, flag_set);
+            return;
+        }
+        run_settings.flags[flag] = true;
+    }
+    run_settings.flags[MinVerbosity] = true;
+    run_settings.flags[MaxVerbosity] = false;
+    
+    int channel[2];
+    if(pipe(channel) != 0)
+        return;
+    
+    size_t start = get_time();
+    pid_t child = fork();
+    if(child == 0) {
+        close(channel[0]);
+        Instance instance(fname, run_settings.tree_mb << 20);
+        if(!instance.is_valid())
+            _exit(2);
+        
+        std::string row, reason;
+        CliqueTreeSolver dp(run_settings, instance);
+        if(run_settings.flags[CliqueTrees] && dp.prepare(reason)) {
+            dp.solve();
+            row = format("%,%,%,,", to_string(dp.solution().score), dp.time(), dp.states());
+        } else {
+            Solver solver(run_settings, instance, instance.domains.size());
+            solver.solve();
+            row = format("%,%,%,%,%", to_string(solver.solution().score),
+                solver.statistics().time(), solver.statistics().visits(),
+                solver.option_hit_rate(), solver.skeleton_recurrence_rate());
+        }
+        ssize_t written = write(channel[1], row.data(), row.size());
+        _exit(written == ssize_t(row.size())? 0: 3);
+    }
+    close(channel[1]);
+    
+    std::string row;
+    char buffer[256];
+    for(ssize_t bytes; (bytes = read(channel[0], buffer, sizeof(buffer))) > 0;)
+        row.append(buffer, bytes);
+    close(channel[0]);
+    
+    int status = 0;
+    struct rusage usage;
+    if(child < 0 || wait4(child, &status, 0, &usage) < 0) {
+        print("%,%,failed,,,,,,\n", fname, flag_set);
+        return;
+    }
+    size_t wall = get_time() - start;
+    
+    bool solved = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    print("%,%,%,%,%,%\n", fname, flag_set, solved? "solved": "failed",
+        solved? row: ",,,,", wall, usage.ru_maxrss >> 10);
+}
+
+void Benchmark::run() {
+    print("file,flags,status,score,search_ms,nodes,option_hit_rate,skeleton_recurrence_rate,wall_ms,peak_rss_mb\n");
+    for(const std::string& fname: files)
+        for(const std::string& flag_set: flag_sets)
+            run(fname, flag_set);
+}
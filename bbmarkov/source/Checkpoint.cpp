@@ -0,0 +1,116 @@
+#include <Checkpoint.hpp>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+
+static const char * checkpoint_magic = "bbmarkov-checkpoint";
+static const uint checkpoint_version = 2;
+
+static std::atomic<bool> terminating(false);
+
+static void on_termination(int) {
+    terminating = true;
+}
+
+void catch_termination() {
+    std::signal(SIGTERM, on_termination);
+    std::signal(SIGINT, on_termination);
+}
+
+bool termination_requested() {
+    return terminating.load(std::memory_order_relaxed);
+}
+
+std::string absolute_path(const std::string& fname) {
+    char * resolved = realpath(fname.c_str(), nullptr);
+    if(!resolved)
+        return fname;
+    std::string path(resolved);
+    std::free(resolved);
+    return path;
+}
+
+template<typename T>
+static void write_list(std::ostream& output, const char * name, const std::vector<T>& list) {
+    output << name << " " << list.size();
+    for(const T& value: list)
+        output << " " << value;
+    output << "\n";
+}
+
+template<typename T>
+static bool read_list(std::istream& input, const char * name, std::vector<T>& list) {
+    std::string label;
+    size_t size;
+    if(!(input >> label >> size) || label != name)
+        return false;
+    list.resize(size);
+    for(T& value: list)
+        input >> value;
+    return bool(input);
+}
+
+// Written to a temporary file that replaces the old checkpoint only once it's
+// complete, so an interruption during the write keeps the previous one.
+bool Checkpoint::write(const std::string& fname) const {
+    std::string temporary = fname + ".tmp";
+    {
+        std::ofstream output(temporary);
+        if(!output.is_open())
+            return false;
+        
+        output << std::setprecision(17);
+        output << checkpoint_magic << " " << checkpoint_version << "\n";
+        output << "instance " << instance << "\n";
+        output << "checksum " << checksum << "\n";
+        output << "flags " << flags << " " << variables << "\n";
+        write_list(output, "positions", positions);
+        write_list(output, "options", options);
+        output << "incumbent " << score << "\n";
+        write_list(output, "parentsets", parentsets);
+        output << "elapsed " << elapsed << "\n";
+        write_list(output, "visits", layer_visits);
+        output << "counters " << recurring_skeletons << " " << option_hits << " "
+            << tight_UBs << " " << successful_tight_UBs << "\n";
+        
+        output.flush();
+        if(!output)
+            return false;
+    }
+    return std::rename(temporary.c_str(), fname.c_str()) == 0;
+}
+
+bool Checkpoint::read(const std::string& fname) {
+    std::ifstream input(fname);
+    std::string label;
+    uint version;
+    if(!(input >> label >> version) || label != checkpoint_magic || version != checkpoint_version)
+        return false;
+    
+    if(!(input >> label) || label != "instance")
+        return false;
+    input >> std::ws;
+    std::getline(input, instance);
+    if(!(input >> label >> checksum) || label != "checksum")
+        return false;
+    
+    if(!(input >> label >> flags >> variables) || label != "flags")
+        return false;
+    if(!read_list(input, "positions", positions) || !read_list(input, "options", options))
+        return false;
+    if(!(input >> label >> score) || label != "incumbent")
+        return false;
+    if(!read_list(input, "parentsets", parentsets))
+        return false;
+    if(!(input >> label >> elapsed) || label != "elapsed")
+        return false;
+    if(!read_list(input, "visits", layer_visits))
+        return false;
+    
+    input >> label >> recurring_skeletons >> option_hits >> tight_UBs >> successful_tight_UBs;
+    return input && label == "counters" && positions.size() == options.size() &&
+        parentsets.size() == variables && layer_visits.size() == variables;
+}
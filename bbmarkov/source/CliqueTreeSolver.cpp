@@ -0,0 +1,320 @@
+#include <CliqueTreeSolver.hpp>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <thread>
+
+// Set scores computed in different orders may differ by rounding
+#define EQUIVALENCE_TOLERANCE 1e-6
+
+static inline uint32_t next_subset(uint32_t subset) {
+    uint32_t lowest = subset & -subset, ripple = subset + lowest;
+    return ripple | (((subset ^ ripple) >> 2) / lowest);
+}
+
+CliqueTreeSolver::CliqueTreeSolver(const Settings& s, Instance& i):
+    settings(s),
+    instance(i),
+    N(i.domains.size()),
+    K(std::min<size_t>(i.max_pset + 1, i.domains.size())),
+    start_time(get_time()),
+    search_time(0),
+    state_count(0),
+    memory(0),
+    optimum(-INF),
+    best(-INF, i.domains.size(), i.domains.size()) {}
+
+Score CliqueTreeSolver::local_score(uint var, uint32_t parents) const {
+    return instance.domains[var][instance.domain_lookup[var].at(VarSet(parents))].score;
+}
+
+// The positions of the subset's vertices among the vertices outside the set
+uint32_t CliqueTreeSolver::squeeze(uint32_t subset, uint32_t set) const {
+    uint32_t squeezed = 0;
+    for(uint var = 0, position = 0; var < N; var++) {
+        if(set >> var & 1)
+            continue;
+        if(subset >> var & 1)
+            squeezed |= 1u << position;
+        position++;
+    }
+    return squeezed;
+}
+
+// Scores every set of at most K vertices, checks that the order of its vertices
+// doesn't matter and lays out the tables.
+bool CliqueTreeSolver::prepare(std::string& reason) {
+    if(N > MAX_CLIQUE_TREE_VARIABLES) {
+        reason = format("the instance has % variables, more than %", N, MAX_CLIQUE_TREE_VARIABLES);
+        return false;
+    }
+    
+    set_ids.assign(size_t(1) << N, -1);
+    for(uint size = 0; size <= K; size++)
+        for(uint32_t set = (1u << size) - 1; set < (1u << N); set = size? next_subset(set): 1u << N) {
+            set_ids[set] = sets.size();
+            sets.push_back(set);
+        }
+    
+    set_scores.assign(sets.size(), 0);
+    for(uint id = 1; id < sets.size(); id++) {
+        uint32_t set = sets[id];
+        for(uint32_t bits = set; bits; bits &= bits - 1) {
+            uint var = __builtin_ctz(bits);
+            uint32_t parents = set ^ (1u << var);
+            size_t pset = instance.domain_lookup[var].find(VarSet(parents));
+            if(pset == DomainLookup::None) {
+                reason = format("the scores don't list every parent set of at most % variables", K - 1);
+                return false;
+            }
+            
+            Score score = set_scores[set_ids[parents]] + instance.domains[var][pset].score;
+            if(bits == set)
+                set_scores[id] = score;
+            else if(std::fabs(score - set_scores[id]) > EQUIVALENCE_TOLERANCE * std::max(1.0, std::fabs(score))) {
+                reason = "the scores aren't score-equivalent";
+                return false;
+            }
+        }
+    }
+    
+    outsiders.assign(sets.size() * N, 0);
+    separators.resize(sets.size());
+    for(uint id = 0; id < sets.size(); id++) {
+        uint32_t set = sets[id];
+        for(uint var = 0, i = 0; var < N; var++)
+            if(!(set >> var & 1))
+                outsiders[id * N + i++] = var;
+        
+        size_t entries = size_t(1) << width(id);
+        if(set && width(id))
+            memory += 2 * entries * sizeof(Score);
+        if(uint(__builtin_popcount(set)) < K)
+            memory += entries * sizeof(Score);
+        if(!set)
+            continue;
+        
+        for(uint32_t subset = set; ; subset = (subset - 1) & set) {
+            if(uint(__builtin_popcount(subset)) < K) {
+                Separator separator {uint(set_ids[subset]), std::vector<uint>()};
+                uint32_t added = set ^ subset;
+                for(uint32_t bits = added; bits; bits &= bits - 1) {
+                    uint var = __builtin_ctz(bits);
+                    separator.positions.push_back(var - __builtin_popcount(subset & ((1u << var) - 1)));
+                }
+                separators[id].push_back(separator);
+            }
+            if(!subset)
+                break;
+        }
+    }
+    
+    state_count = memory / sizeof(Score);
+    if(memory > settings.dp_mb << 20) {
+        reason = format("its tables would take % MB, more than --dp-mb", memory >> 20);
+        return false;
+    }
+    return true;
+}
+
+template<typename Function>
+void CliqueTreeSolver::parallel_for(size_t count, const Function& function) {
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+        for(size_t i = next++; i < count; i = next++)
+            function(i);
+    };
+    
+    std::vector<std::thread> pool;
+    for(size_t w = 1; w < std::min<size_t>(settings.threads, count); w++)
+        pool.push_back(std::thread(work));
+    work();
+    for(std::thread& thread: pool)
+        thread.join();
+}
+
+// The best g(S, R) whose root clique extends the set 'id' with vertices of 'rest'
+// from the position 'from' on. 'rest' is in the coordinates of the set.
+Score CliqueTreeSolver::extend(uint id, uint32_t rest, uint from, Score separator_score) {
+    Score best_value = -INF;
+    for(uint position = from; position < width(id); position++) {
+        if(!(rest >> position & 1))
+            continue;
+        
+        uint32_t clique = sets[id] | 1u << outside(id, position);
+        uint c = set_ids[clique];
+        uint32_t remaining = remove_bit(rest, position);
+        
+        Score value = set_scores[c] - separator_score + h[c][remaining];
+        if(best_value < value)
+            best_value = value;
+        if(uint(__builtin_popcount(clique)) < K) {
+            value = extend(c, remaining, position, separator_score);
+            if(best_value < value)
+                best_value = value;
+        }
+    }
+    return best_value;
+}
+
+void CliqueTreeSolver::fill_separator(uint id, uint layer) {
+    uint w = width(id);
+    if(layer > w)
+        return;
+    
+    std::vector<Score>& subtrees = g[id];
+    for(uint32_t rest = (1u << layer) - 1; rest < (1u << w); rest = next_subset(rest))
+        subtrees[rest] = extend(id, rest, 0, set_scores[id]);
+}
+
+void CliqueTreeSolver::fill_clique(uint id, uint layer) {
+    uint w = width(id);
+    if(layer > w)
+        return;
+    
+    std::vector<Score>& subtrees = a[id];
+    for(uint32_t rest = (1u << layer) - 1; rest < (1u << w); rest = next_subset(rest)) {
+        Score value = -INF;
+        for(const Separator& separator: separators[id]) {
+            uint32_t subset = rest;
+            for(uint position: separator.positions)
+                subset = insert_bit(subset, position);
+            if(value < g[separator.id][subset])
+                value = g[separator.id][subset];
+        }
+        subtrees[rest] = value;
+    }
+    
+    // Each partition of U is tried once, with its lowest vertex in the first part
+    std::vector<Score>& hangings = h[id];
+    for(uint32_t rest = (1u << layer) - 1; rest < (1u << w); rest = next_subset(rest)) {
+        uint32_t lowest = rest & -rest, others = rest ^ lowest;
+        Score value = -INF;
+        for(uint32_t subset = others; ; subset = (subset - 1) & others) {
+            uint32_t part = lowest | subset;
+            Score candidate = subtrees[part] + hangings[rest ^ part];
+            if(value < candidate)
+                value = candidate;
+            if(!subset)
+                break;
+        }
+        hangings[rest] = value;
+    }
+}
+
+// Repeats the choices behind g(S, R), directing each clique from its separator
+void CliqueTreeSolver::build_subtree(uint32_t separator, uint32_t rest, ArcMatrix& dag) {
+    uint s = set_ids[separator];
+    Score target = g[s][squeeze(rest, separator)];
+    
+    for(uint32_t added = rest; added; added = (added - 1) & rest) {
+        uint32_t clique = separator | added;
+        if(uint(__builtin_popcount(clique)) > K)
+            continue;
+        
+        uint c = set_ids[clique];
+        if(set_scores[c] - set_scores[s] + h[c][squeeze(rest ^ added, clique)] != target)
+            continue;
+        
+        uint32_t parents = separator;
+        for(uint32_t bits = added; bits; bits &= bits - 1) {
+            uint var = __builtin_ctz(bits);
+            dag[var] = VarSet(parents);
+            parents |= 1u << var;
+        }
+        build_children(clique, rest ^ added, dag);
+        return;
+    }
+    assert(false);
+}
+
+void CliqueTreeSolver::build_children(uint32_t clique, uint32_t rest, ArcMatrix& dag) {
+    uint c = set_ids[clique];
+    while(rest) {
+        Score target = h[c][squeeze(rest, clique)];
+        uint32_t lowest = rest & -rest, others = rest ^ lowest, part = 0;
+        
+        for(uint32_t subset = others; ; subset = (subset - 1) & others) {
+            Score value = a[c][squeeze(lowest | subset, clique)];
+            if(value + h[c][squeeze(rest ^ lowest ^ subset, clique)] == target) {
+                part = lowest | subset;
+                for(const Separator& separator: separators[c])
+                    if(g[separator.id][squeeze(part, sets[separator.id])] == value) {
+                        build_subtree(sets[separator.id], part, dag);
+                        break;
+                    }
+                break;
+            }
+            if(!subset)
+                break;
+        }
+        assert(part);
+        if(!part)
+            return;
+        rest ^= part;
+    }
+}
+
+void CliqueTreeSolver::solve() {
+    start_time = get_time();
+    
+    g.resize(sets.size());
+    a.resize(sets.size());
+    h.resize(sets.size());
+    std::vector<uint> separator_ids, clique_ids;
+    for(uint id = 0; id < sets.size(); id++) {
+        size_t entries = size_t(1) << width(id);
+        if(uint(__builtin_popcount(sets[id])) < K) {
+            g[id].assign(entries, -INF);
+            separator_ids.push_back(id);
+        }
+        if(sets[id] && width(id)) {
+            a[id].assign(entries, -INF);
+            h[id].assign(entries, -INF);
+            h[id][0] = 0;
+            clique_ids.push_back(id);
+        } else if(sets[id])
+            h[id].assign(1, 0);
+    }
+    
+    for(uint layer = 1; layer <= N; layer++) {
+        parallel_for(separator_ids.size(), [&](size_t i) {
+            fill_separator(separator_ids[i], layer);
+        });
+        parallel_for(clique_ids.size(), [&](size_t i) {
+            fill_clique(clique_ids[i], layer);
+        });
+    }
+    
+    uint32_t all = (1u << N) - 1;
+    optimum = g[0][all];
+    ArcMatrix dag(N, VarSet());
+    build_subtree(0, all, dag);
+    
+    Score score = 0;
+    for(uint var = 0; var < N; var++)
+        score += local_score(var, dag[var].to_ulong());
+    best = Solution::construct(instance.domains, instance.domain_lookup, Network(dag, score));
+    search_time = get_time() - start_time;
+    output();
+}
+
+void CliqueTreeSolver::output() {
+    if(settings.silent)
+        return;
+    if(settings.flags[MinVerbosity])
+        std::cout << search_time << "\t" << to_string(best.score) << "\tSolution" << std::endl;
+    
+    std::cout << "-------- Solution -------- [" << formatted_time(search_time) << "]\n";
+    best.print(instance.domains);
+    std::cout << std::endl;
+    if(settings.flags[MinVerbosity])
+        return;
+    
+    print("Search statistics:\n");
+    print("  Used % (after the input was read)\n", formatted_time(search_time));
+    print("  Solution fingerprint: '%'\n", best.fingerprint());
+    print("  Filled % clique tree DP entries (% MB) for cliques of at most % variables\n",
+        state_count, memory >> 20, K);
+    print("  Decomposable score of the optimal junction tree: %\n", to_string(optimum));
+}
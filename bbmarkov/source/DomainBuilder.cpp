@@ -1,34 +1,27 @@
 #include <DomainBuilder.hpp>
-
-bool OptionsSort::operator()(size_t a, size_t b) const {
-
-    if(calculate_ub) {
-        Score s1 = (* calculate_ub)(a / domains[0].size(), a % domains[0].size());
-        Score s2 = (* calculate_ub)(b / domains[0].size(), b % domains[0].size());
-        
-        if(s1 != s2)
-            return s1 > s2;
-    } else {
-        Score s1 = domains[a / domains[0].size()][a % domains[0].size()].score;
-        Score s2 = domains[b / domains[0].size()][b % domains[0].size()].score;
-
-        if(s1 != s2)
-            return s1 > s2;
-    }
-    return a < b;
-}
+#include <algorithm>
 
 DomainBuilder::DomainBuilder(
 Instance& i,
 Solution& s,
-ValueCalculator * ubc,
-uint mv):
+MarkovBounder * b,
+Score lb,
+uint mv,
+OptionList& buffer,
+std::vector<Score>& child_buffer,
+SupersetMemo& memo):
     instance(i),
     state(s),
-    option_list(OptionsSort { ubc, instance.domains }),
-    calculate_ub(ubc),
+    superset_scores(memo),
+    option_list(buffer),
+    bounds(b),
+    lowerbound(lb),
+    child_bounds(child_buffer),
     N(mv) {
     
+    option_list.clear();
+    if(bounds)
+        bounds->fast_child_upperbounds(child_bounds);
     latest_var = 0;
     for(uint v = 1; v < N; v++)
         if(state.contains(v) && (!state.contains(latest_var) ||
@@ -39,7 +32,7 @@ uint mv):
 #define parents_of(var) \
     instance.domains[var][state[var].parentset]
 
-Score DomainBuilder::build_supersets(uint var, std::bitset<32> subset) {
+Score DomainBuilder::build_supersets(uint var, VarSet subset) {
     Score maximum = -INF;
     
     for(uint added = 0; added < N; added++) {
@@ -58,39 +51,26 @@ Score DomainBuilder::build_supersets(uint var, std::bitset<32> subset) {
     return maximum;
 }
 
-bool DomainBuilder::in_same_subgraph(std::bitset<32>& visited, uint vertex, uint target) {
-    if(visited.test(vertex)) return false;
-    if(vertex == target) return true;
-    visited.set(vertex);
-    for(uint parent: instance.domains[vertex][state[vertex].parentset].list)
-        if(in_same_subgraph(visited, parent, target))
-            return true;
-    return false;
-}
-
+// Placing var below a later vertex v is redundant when v's parents are among the new
+// parents and v is an ancestor of one of them.
 bool DomainBuilder::worsens_lexicographicality(uint var, const ParentSet& parentset) {
-    for(uint v = var + 1; v < N; v++) {
-        if(!state.contains(v))
-            continue;
-
-        auto content = instance.domains[v][state[v].parentset].content;
-        if(content == (content & parentset.content)) {
-            std::bitset<32> visited;
-            for(uint parent: parentset.list)
-                if(in_same_subgraph(visited, parent, v))
-                    return true;
+    VarSet later = state.ancestors_of(parentset) & ~full_set(var + 1);
+    for(uint word = 0; word * 64 < VARIABLES; word++)
+        for(uint64_t bits = set_word(later, word); bits; bits &= bits - 1) {
+            uint v = word * 64 + __builtin_ctzll(bits);
+            auto content = instance.domains[v][state[v].parentset].content;
+            if(content == (content & parentset.content))
+                return true;
         }
-    }
     return false;
 }
 
-Score DomainBuilder::build(uint var, const std::bitset<32>& subset) {
-
-    auto it = superset_scores.find(subset);
-    if(it != superset_scores.end())
-        return it->second;        
+Score DomainBuilder::build(uint var, const VarSet& subset) {
 
     size_t pset = instance.domain_lookup[var].at(subset);
+    if(superset_scores.stamps[pset] == superset_scores.generation)
+        return superset_scores.maxima[pset];
+
     if(worsens_lexicographicality(var, instance.domains[var][pset]))
         return -INF;
     
@@ -99,29 +79,42 @@ Score DomainBuilder::build(uint var, const std::bitset<32>& subset) {
 
     if(maximum < instance.domains[var][pset].score) {
         maximum = instance.domains[var][pset].score;
-        option_list.insert(pset + var * instance.domains[0].size());
+        // With a bounder, options are sorted by the best total score reachable after
+        // them, and the ones that can't beat the lower bound are left out. They still
+        // count towards the fingerprint, since their subtrees are known to be no better.
+        Score key = maximum;
+        if(bounds)
+            key += child_bounds[var];
+        if(!bounds || key > lowerbound)
+            option_list.push_back(Option { key, instance.option(var, pset) });
+        fingerprint.add(instance.option(var, pset));
     }
 
-    superset_scores.insert(std::make_pair(subset, maximum));
+    superset_scores.stamps[pset] = superset_scores.generation;
+    superset_scores.maxima[pset] = maximum;
     return maximum;
 }
 
 void DomainBuilder::construct_for(uint var) {
-    superset_scores.clear();
+    superset_scores.reset(instance.domains[var].size());
     uint min_depth = state[latest_var].depth + (var < latest_var);
     
     if(state.assign_mask.none() || !min_depth)
-        build(var, std::bitset<32>());
+        build(var, VarSet());
     else {
         for(uint v = 0; v < N; v++)
             if(state.contains(v) && state[v].depth + 1 >= min_depth) {
-                std::bitset<32> subset;
+                VarSet subset;
                 subset.set(v);
                 build(var, subset);
             }
     }
 }
 
+void DomainBuilder::sort() {
+    std::sort(option_list.begin(), option_list.end());
+}
+
 uint DomainBuilder::get_depth(const Solution& state, const ParentSet& parentset) {
     uint depth = 0;
     for(uint parent: parentset.list)
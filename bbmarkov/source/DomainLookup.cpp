@@ -0,0 +1,79 @@
+#include <DomainLookup.hpp>
+#include <algorithm>
+
+static struct BinomialTable {
+    size_t values[VARIABLES + 1][DomainLookup::MaxRankedSize + 2];
+    
+    BinomialTable() {
+        for(uint n = 0; n <= VARIABLES; n++)
+            for(uint k = 0; k <= DomainLookup::MaxRankedSize + 1; k++)
+                values[n][k] = k > n? 0: k == 0 || k == n? 1:
+                    values[n - 1][k - 1] + values[n - 1][k];
+    }
+} binomials;
+
+size_t DomainLookup::binomial(uint n, uint k) {
+    return binomials.values[n][k];
+}
+
+bool mask_less(const VarSet& a, const VarSet& b) {
+    for(uint word = (VARIABLES + 63) / 64; word-- > 0;)
+        if(set_word(a, word) != set_word(b, word))
+            return set_word(a, word) < set_word(b, word);
+    return false;
+}
+
+void DomainLookup::build(const Domain& domain, uint N, const uint32_t * order) {
+    size_t largest = 0;
+    for(const ParentSet& parentset: domain)
+        largest = std::max(largest, parentset.count());
+    
+    size_t entries = 0;
+    offsets.clear();
+    for(uint k = 0; k <= largest && largest <= MaxRankedSize; k++) {
+        offsets.push_back(entries);
+        entries += binomial(N, k);
+    }
+    offsets.push_back(entries);
+    
+    ranked = largest <= MaxRankedSize && entries <= 4 * domain.size() + 1024;
+    if(ranked) {
+        table.assign(entries, uint32_t(-1));
+        for(size_t pset = 0; pset < domain.size(); pset++)
+            table[offsets[domain[pset].count()] + rank(domain[pset].content)] = pset;
+        return;
+    }
+    
+    offsets.clear();
+    sorted.reserve(domain.size());
+    for(size_t i = 0; i < domain.size(); i++) {
+        size_t pset = order? order[i]: i;
+        sorted.push_back(std::make_pair(domain[pset].content, uint32_t(pset)));
+    }
+    if(!order)
+        std::sort(sorted.begin(), sorted.end(),
+        [](const std::pair<VarSet, uint32_t>& a, const std::pair<VarSet, uint32_t>& b) {
+            return mask_less(a.first, b.first);
+        });
+}
+
+size_t DomainLookup::search(const VarSet& subset) const {
+    auto it = std::lower_bound(sorted.begin(), sorted.end(), subset,
+    [](const std::pair<VarSet, uint32_t>& entry, const VarSet& subset) {
+        return mask_less(entry.first, subset);
+    });
+    if(it == sorted.end() || it->first != subset)
+        return None;
+    return it->second;
+}
+
+size_t DomainLookup::memory() const {
+    return table.capacity() * sizeof(uint32_t) +
+        sorted.capacity() * sizeof(std::pair<VarSet, uint32_t>);
+}
+
+void initialize_lookup_table(std::vector<DomainLookup>& domain_lookup, const Domains& domains) {
+    domain_lookup.assign(domains.size(), DomainLookup());
+    for(uint var = 0; var < domains.size(); var++)
+        domain_lookup[var].build(domains[var], domains.size());
+}
@@ -0,0 +1,133 @@
+#include <Generator.hpp>
+#include <TranspositionTable.hpp>
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <cmath>
+#include <iomanip>
+
+// Fit of an empty model per variable and the penalty weight of a parameter,
+// roughly those of BIC with a thousand samples
+#define BASE_SCORE 100
+#define PARAMETER_PENALTY 0.25
+
+class ScoreModel {
+public:
+    ScoreModel(const GeneratorSettings& s):
+        settings(s),
+        random(s.seed),
+        parents(s.variables, VarSet()),
+        strengths(s.variables, std::vector<double>(s.variables, 0)),
+        bases(s.variables) {
+        
+        std::uniform_real_distribution<double> base(-10, 10), strength(4, 12);
+        for(uint v = 0; v < settings.variables; v++)
+            bases[v] = -BASE_SCORE + base(random);
+        
+        // Each vertex takes its parents among a clique formed by an earlier
+        // vertex and its parents, so the parents always form a clique.
+        std::vector<uint> order(settings.variables);
+        for(uint v = 0; v < settings.variables; v++)
+            order[v] = v;
+        std::shuffle(order.begin(), order.end(), random);
+        
+        for(uint i = 1; i < settings.variables; i++) {
+            uint v = order[i], u = order[random() % i];
+            std::vector<uint> clique {u};
+            for(uint p = 0; p < settings.variables; p++)
+                if(parents[u][p])
+                    clique.push_back(p);
+            std::shuffle(clique.begin(), clique.end(), random);
+            
+            size_t size = random() % (std::min<size_t>(settings.max_pset, clique.size()) + 1);
+            for(size_t j = 0; j < size; j++) {
+                parents[v].set(clique[j]);
+                strengths[v][clique[j]] = strengths[clique[j]][v] = strength(random);
+            }
+        }
+    }
+    
+    double set_score(const std::vector<uint>& set) const {
+        double score = 0;
+        for(size_t i = 0; i < set.size(); i++) {
+            score += bases[set[i]];
+            for(size_t j = 0; j < i; j++)
+                score += strengths[set[i]][set[j]];
+        }
+        
+        if(set.size() >= 2) {
+            double parameters = std::pow(settings.arity, set.size()) - 1 -
+                set.size() * (settings.arity - 1);
+            score -= PARAMETER_PENALTY * parameters;
+            score += settings.noise * noise(set);
+        }
+        return score;
+    }
+    
+    double local_score(uint var, std::vector<uint> parentset) const {
+        double without = set_score(parentset);
+        parentset.push_back(var);
+        std::sort(parentset.begin(), parentset.end());
+        return set_score(parentset) - without;
+    }
+
+protected:
+    // A standard normal value that depends only on the set and the seed
+    double noise(const std::vector<uint>& set) const {
+        uint64_t hash = mix64(settings.seed);
+        for(uint v: set)
+            hash = mix64(hash ^ (v + 1));
+        const double unit = 1.0 / double(uint64_t(1) << 53);
+        double u1 = ((mix64(hash) >> 11) + 1) * unit, u2 = (mix64(~hash) >> 11) * unit;
+        return std::sqrt(-2 * std::log(u1)) * std::cos(2 * M_PI * u2);
+    }
+
+private:
+    const GeneratorSettings& settings;
+    std::mt19937_64 random;
+    std::vector<VarSet> parents;
+    std::vector<std::vector<double> > strengths;
+    std::vector<double> bases;
+};
+
+static void list_parentsets(uint var, uint N, uint max_pset, std::vector<uint>& current,
+        std::vector<std::vector<uint> >& parentsets) {
+    parentsets.push_back(current);
+    if(current.size() == max_pset)
+        return;
+    for(uint v = current.empty()? 0: current.back() + 1; v < N; v++) {
+        if(v == var)
+            continue;
+        current.push_back(v);
+        list_parentsets(var, N, max_pset, current, parentsets);
+        current.pop_back();
+    }
+}
+
+bool generate_scores(const std::string& fname, const GeneratorSettings& settings) {
+    uint N = settings.variables;
+    if(N == 0 || N > VARIABLES || settings.arity < 2)
+        return false;
+    
+    std::ofstream output(fname);
+    if(!output.is_open())
+        return false;
+    
+    ScoreModel model(settings);
+    output << std::fixed << std::setprecision(6) << N << "\n";
+    
+    for(uint var = 0; var < N; var++) {
+        std::vector<uint> current;
+        std::vector<std::vector<uint> > parentsets;
+        list_parentsets(var, N, std::min(settings.max_pset, N - 1), current, parentsets);
+        
+        output << var << " " << parentsets.size() << "\n";
+        for(const std::vector<uint>& parentset: parentsets) {
+            output << model.local_score(var, parentset) << " " << parentset.size();
+            for(uint parent: parentset)
+                output << " " << parent;
+            output << "\n";
+        }
+    }
+    return bool(output);
+}
@@ -1,17 +1,45 @@
 #include <Instance.hpp>
+#include <ScoreFile.hpp>
+#include <algorithm>
+#include <cstring>
 
-void Instance::init(std::istream& input) {
+void Instance::init(std::istream& input, size_t tree_budget) {
     read_cussen_scores(input, domains);
+    if(!is_valid())
+        return;
     initialize_lookup_table(domain_lookup, domains);
-    score_tree.assign(domains.size(), ScoreTree(domains.size()));
+    prepare(tree_budget);
+}
+
+bool Instance::init(const std::string& fname, size_t tree_budget) {
+    MappedFile file;
+    if(!file.open(fname) || !is_binary_scores(file))
+        return false;
+    
+    if(!read_binary_scores(file, domains, domain_lookup))
+        domains.clear();
+    else if(is_valid())
+        prepare(tree_budget);
+    return true;
+}
+
+void Instance::prepare(size_t tree_budget) {
+    for(const Domain& domain: domains)
+        stride = std::max(stride, domain.size());
     
-    for(size_t i = 0; i < domains.size(); i++)
-        score_tree[i].construct(domains[i], domain_lookup[i]);
+    ScoreTree::Mode mode = ScoreTree::choose_mode(domains.size(), stride, tree_budget);
+    
+    score_tree.swap(recycled);
+    score_tree.resize(domains.size(), ScoreTree(domains.size(), mode));
+    for(size_t i = 0; i < domains.size(); i++) {
+        score_tree[i].reset(domains.size(), mode);
+        score_tree[i].construct(domains[i]);
+    }
     
-    std::bitset<32> subset;
+    VarSet subset;
     for(uint var = 1; var < domains.size(); var++) {
         subset.set(var, true);
-        if(domain_lookup[0].find(subset) == domain_lookup[0].end())
+        if(!domain_lookup[0].contains(subset))
             break;
         max_pset++;
     }
@@ -28,10 +56,39 @@ bool read_till(const std::string& string, size_t& i, std::string& target, char c
     return false;
 }
 
-Instance::Instance(const std::string& fname): max_pset(0) {
+// FNV-1a over the scores and parent sets, which identifies the scores of a Bayes
+// table file or a checkpoint
+size_t Instance::checksum() const {
+    size_t hash = 14695981039346656037ull;
+    for(const Domain& domain: domains)
+        for(const ParentSet& parentset: domain) {
+            uint64_t bits;
+            std::memcpy(&bits, &parentset.score, sizeof(bits));
+            hash = (hash ^ bits) * 1099511628211ull;
+            for(uint word = 0; word * 64 < VARIABLES; word++)
+                hash = (hash ^ set_word(parentset.content, word)) * 1099511628211ull;
+        }
+    return hash;
+}
+
+size_t Instance::tree_memory() const {
+    size_t total = 0;
+    for(const ScoreTree& tree: score_tree)
+        total += tree.memory();
+    return total;
+}
+
+Instance::Instance(const std::string& fname, size_t tree_budget,
+        std::vector<ScoreTree> * trees): max_pset(0), stride(1) {
+    if(trees)
+        recycled.swap(* trees);
+    
+    if(init(fname, tree_budget))
+        return;
+    
     std::ifstream file(fname);
     if(file.is_open()) {
-        init(file);
+        init(file, tree_budget);
         return;
     }
     
@@ -46,5 +103,5 @@ Instance::Instance(const std::string& fname): max_pset(0) {
         vars, pset, name, vars, pset));
     
     if(alternative.is_open())
-        init(alternative);
+        init(alternative, tree_budget);
 }
\ No newline at end of file
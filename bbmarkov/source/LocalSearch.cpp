@@ -0,0 +1,177 @@
+#include <LocalSearch.hpp>
+#include <Solution.hpp>
+
+// Moves that gain less than this are treated as noise from summing scores.
+#define MIN_GAIN 1e-9
+#define PERTURBATION 3
+
+LocalSearch::LocalSearch(Instance& i, Incumbent& inc, const Network& b, uint mv):
+    instance(i),
+    incumbent(inc),
+    bayes(b.matrix),
+    N(mv),
+    random(mv),
+    stopping(false),
+    published(0) {
+    
+    for(uint var = 0; var < N; var++)
+        bayes[var].reset(var);
+}
+
+LocalSearch::~LocalSearch() {
+    stop();
+}
+
+void LocalSearch::start() {
+    thread = std::thread(&LocalSearch::run, this);
+}
+
+void LocalSearch::stop() {
+    stopping = true;
+    if(thread.joinable())
+        thread.join();
+}
+
+Network LocalSearch::from_incumbent() const {
+    Solution solution = incumbent.solution();
+    ArcMatrix matrix(N, VarSet());
+    for(uint var = 0; var < N; var++)
+        matrix[var] = instance.domains[var][solution[var].parentset].content;
+    return Network(std::move(matrix), solution.score);
+}
+
+Score LocalSearch::local_score(uint var, const VarSet& parents) const {
+    if(parents.count() > instance.max_pset)
+        return -INF;
+    size_t pset = instance.domain_lookup[var].find(parents);
+    return pset == DomainLookup::None? -INF: instance.domains[var][pset].score;
+}
+
+// Lists the moves that keep the network acyclic and free of immoralities.
+// Adding p -> c needs every parent of c to be adjacent to p, removing p -> c
+// must not leave a common child to p and c, and reversing p -> c needs the
+// parents of p to be adjacent to c.
+void LocalSearch::find_moves(const Network& network, std::vector<Move>& moves) {
+    moves.clear();
+    
+    std::vector<VarSet> adjacent(N), children(N, VarSet());
+    for(uint var = 0; var < N; var++)
+        for(uint p = 0; p < N; p++)
+            if(network.matrix[var][p])
+                children[p].set(var);
+    for(uint var = 0; var < N; var++)
+        adjacent[var] = network.matrix[var] | children[var];
+    
+    for(uint c = 0; c < N; c++) {
+        const VarSet& parents = network.matrix[c];
+        Score current = local_score(c, parents);
+        
+        for(uint p = 0; p < N; p++) {
+            if(p == c)
+                continue;
+            
+            if(!adjacent[c][p]) {
+                if(ancestors[p][c] || (parents & ~adjacent[p]).any())
+                    continue;
+                VarSet added = parents;
+                added.set(p);
+                Score score = local_score(c, added);
+                if(score != -INF)
+                    moves.push_back(Move {score - current, c, p, Add});
+                continue;
+            }
+            if(!parents[p])
+                continue;
+            
+            VarSet removed = parents;
+            removed.reset(p);
+            Score score = local_score(c, removed);
+            if(score == -INF)
+                continue;
+            if((children[p] & children[c]).none())
+                moves.push_back(Move {score - current, c, p, Remove});
+            
+            bool other_path = false;
+            for(uint q = 0; q < N && !other_path; q++)
+                other_path = removed[q] && ancestors[q][p];
+            if(other_path || (network.matrix[p] & ~adjacent[c]).any())
+                continue;
+            
+            VarSet reversed = network.matrix[p];
+            reversed.set(c);
+            Score gain = local_score(p, reversed);
+            if(gain != -INF)
+                moves.push_back(Move {score - current + gain - local_score(p, network.matrix[p]),
+                    c, p, Reverse});
+        }
+    }
+}
+
+void LocalSearch::apply(Network& network, const Move& move) {
+    network.matrix[move.child].flip(move.parent);
+    if(move.kind == Reverse)
+        network.matrix[move.parent].set(move.child);
+    network.score += move.delta;
+    ancestors = transitive_closure(network.matrix);
+}
+
+bool LocalSearch::climb(Network& network) {
+    find_moves(network, moves);
+    
+    const Move * best = nullptr;
+    for(const Move& move: moves)
+        if(move.delta > MIN_GAIN && (!best || move.delta > best->delta))
+            best = &move;
+    if(!best)
+        return false;
+    apply(network, * best);
+    return true;
+}
+
+void LocalSearch::perturb(Network& network, uint steps) {
+    for(uint step = 0; step < steps; step++) {
+        find_moves(network, moves);
+        if(moves.empty())
+            return;
+        
+        std::vector<Move> towards_bayes;
+        for(const Move& move: moves)
+            if(move.kind == Add && bayes[move.child][move.parent])
+                towards_bayes.push_back(move);
+        
+        if(!towards_bayes.empty() && random() % 2)
+            apply(network, towards_bayes[random() % towards_bayes.size()]);
+        else
+            apply(network, moves[random() % moves.size()]);
+    }
+}
+
+// The score is summed again before publishing so that rounding in the deltas
+// can't pass for an improvement.
+void LocalSearch::publish(const Network& network) {
+    Score score = 0;
+    for(uint var = 0; var < N; var++)
+        score += local_score(var, network.matrix[var]);
+    if(score <= incumbent.score())
+        return;
+    
+    Solution solution = Solution::construct(instance.domains, instance.domain_lookup,
+        Network(network.matrix, score));
+    if(incumbent.offer(solution))
+        published++;
+}
+
+void LocalSearch::run() {
+    Network network = from_incumbent();
+    ancestors = transitive_closure(network.matrix);
+    
+    while(!stopping.load(std::memory_order_relaxed)) {
+        if(climb(network))
+            continue;
+        publish(network);
+        
+        network = from_incumbent();
+        ancestors = transitive_closure(network.matrix);
+        perturb(network, PERTURBATION);
+    }
+}
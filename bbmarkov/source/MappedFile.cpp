@@ -0,0 +1,109 @@
+#include <MappedFile.hpp>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <vector>
+
+MappedFile::MappedFile(): address(nullptr), length(0) {}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+void MappedFile::close() {
+    if(address)
+        munmap(address, length);
+    if(temporary != "")
+        std::remove(temporary.c_str());
+    address = nullptr;
+    length = 0;
+    temporary = "";
+}
+
+bool MappedFile::open(const std::string& fname) {
+    close();
+    int fd = ::open(fname.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+    
+    struct stat info;
+    if(fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    
+    void * mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(mapping == MAP_FAILED)
+        return false;
+    
+    address = (char *) mapping;
+    length = info.st_size;
+    name = fname;
+    return true;
+}
+
+bool MappedFile::create(const std::string& fname, size_t size) {
+    close();
+    temporary = format("%.%.tmp", fname, getpid());
+    
+    int fd = ::open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0 || ftruncate(fd, size) != 0) {
+        if(fd >= 0) ::close(fd);
+        std::remove(temporary.c_str());
+        temporary = "";
+        return false;
+    }
+    
+    void * mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(mapping == MAP_FAILED) {
+        std::remove(temporary.c_str());
+        temporary = "";
+        return false;
+    }
+    
+    address = (char *) mapping;
+    length = size;
+    name = fname;
+    return true;
+}
+
+bool MappedFile::publish() {
+    if(temporary == "")
+        return false;
+    msync(address, length, MS_SYNC);
+    mprotect(address, length, PROT_READ);
+    
+    bool renamed = std::rename(temporary.c_str(), name.c_str()) == 0;
+    if(!renamed)
+        std::remove(temporary.c_str());
+    temporary = "";
+    return renamed;
+}
+
+double MappedFile::residency() const {
+    if(!address)
+        return 0;
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t pages = (length + page - 1) / page;
+    
+    std::vector<unsigned char> resident(pages);
+    if(mincore(address, length, resident.data()) != 0)
+        return 0;
+    
+    size_t count = 0;
+    for(unsigned char flag: resident)
+        count += flag & 1;
+    return double(count) / double(pages);
+}
+
+void MappedFile::page_faults(size_t& minor, size_t& major) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    minor = usage.ru_minflt;
+    major = usage.ru_majflt;
+}
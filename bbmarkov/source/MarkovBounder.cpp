@@ -1,6 +1,8 @@
 #include <MarkovBounder.hpp>
 #include <algorithm>
 
+#define ULTRA_TIGHT 0
+
 template<bool MIN, typename T>
 bool is_reducable(T& data_struct, typename T::iterator& it) {
     auto it2 = it; it2++;
@@ -33,11 +35,14 @@ void reduce(T& data_struct) {
             it++;
 }
 
-MarkovBounder::MarkovBounder(const Solution& f, Instance& i, uint mv):
+MarkovBounder::MarkovBounder(const Solution& f, Instance& i, const BayesSolver& bs, uint mv):
     instance(i),
     N(mv),
-    bayes_solver(instance, mv),
-    state(f) {}
+    bayes_solver(bs),
+    state(f),
+    cliques(mv),
+    seen(1 << 14, Seen {VarSet(), 0, 0}),
+    generation(0) {}
 
 size_t MarkovBounder::best_final_parentset(uint var) const {
     size_t pset = instance.domain_lookup[var].at(0);
@@ -53,10 +58,10 @@ size_t MarkovBounder::best_final_parentset(uint var) const {
     return pset;
 }
 
-size_t MarkovBounder::find_best_relaxedly_moral_parentset(const Cliques* cliques, uint var, const std::bitset<32>& assigned) {
+size_t MarkovBounder::find_best_relaxedly_moral_parentset(const Cliques* cliques, uint var, const VarSet& assigned) {
     
     size_t best = instance.score_tree[var].get(0);
-    for(const std::bitset<32>& clique: cliques[var]) {
+    for(const VarSet& clique: cliques[var]) {
         auto relaxed_clique = clique | (assigned & ~state.assign_mask);
 
         size_t pset = instance.score_tree[var].get(relaxed_clique);
@@ -66,12 +71,23 @@ size_t MarkovBounder::find_best_relaxedly_moral_parentset(const Cliques* cliques
     return best;
 }
 
-Score MarkovBounder::upperbound(const Cliques* cliques, std::bitset<32> assigned,
+inline uint64_t hash_set(const VarSet& set, uint64_t salt) {
+    uint64_t hash = mix64(salt + 0x9e3779b97f4a7c15ULL);
+    for(uint word = 0; word * 64 < VARIABLES; word++)
+        hash = mix64(hash ^ set_word(set, word));
+    return hash;
+}
+
+Score MarkovBounder::upperbound(const Cliques* cliques, VarSet assigned,
         size_t remaining_depth, Score tail_score, Score lb) {
 
     if(!remaining_depth)
         return bayes_solver.solve(assigned);
-
+    
+    Seen& local = seen[hash_set(assigned, 0) & (seen.size() - 1)];
+    if(local.generation == generation && local.assigned == assigned)
+        return local.value;
+    
     Score ub = -INF;
     for(uint var = 0; var < N; var++) {
         if(assigned.test(var))
@@ -80,18 +96,18 @@ Score MarkovBounder::upperbound(const Cliques* cliques, std::bitset<32> assigned
         size_t pset = find_best_relaxedly_moral_parentset(cliques, var, assigned);
         
         assigned.set(var);
-        auto it = seen.find(assigned);
         Score head_score = instance.domains[var][pset].score +
-            (it != seen.end()? it->second:
-                upperbound(cliques, assigned, remaining_depth - 1,
-                    tail_score + instance.domains[var][pset].score, lb));
+            upperbound(cliques, assigned, remaining_depth - 1,
+                tail_score + instance.domains[var][pset].score, lb);
  
         if(lb < tail_score + head_score) return head_score;
         if(ub < head_score) ub = head_score;
         
         assigned.reset(var);
     }
-    seen.insert(std::make_pair(assigned, ub));
+    
+    // Only complete bounds get here; a branch exceeding lb returns early above.
+    seen[hash_set(assigned, 0) & (seen.size() - 1)] = Seen {assigned, ub, generation};
     return ub;
 }
 
@@ -103,10 +119,14 @@ void MarkovBounder::construct_naive_cliques(Cliques& cliques) {
         cliques.back().set(var);
     }
     reduce<false>(cliques);
+    
+    // Without assigned variables, parents can still come from those assigned within the bound
+    if(cliques.empty())
+        cliques.push_back(VarSet());
 }
 
-void MarkovBounder::decompose_clique(Cliques& tight_cliques, std::bitset<32> clique,
-    const Cliques& bad_cliques, size_t i, std::unordered_set<std::bitset<32> >* visited) {    
+void MarkovBounder::decompose_clique(Cliques& tight_cliques, VarSet clique,
+    const Cliques& bad_cliques, size_t i, std::unordered_set<VarSet>* visited) {    
     if(i >= bad_cliques.size()) {
         tight_cliques.push_back(clique);
         return;
@@ -130,15 +150,15 @@ void MarkovBounder::decompose_clique(Cliques& tight_cliques, std::bitset<32> cli
 void MarkovBounder::construct_tight_cliques(Cliques& tight_cliques,
         const Cliques& bad_cliques, const Cliques& naive_cliques) {
     
-    std::unordered_set<std::bitset<32> > visited[bad_cliques.size()];
-    for(const std::bitset<32>& clique: naive_cliques)
+    std::unordered_set<VarSet> visited[bad_cliques.size()];
+    for(const VarSet& clique: naive_cliques)
         decompose_clique(tight_cliques, clique, bad_cliques, 0, visited);
     reduce<false>(tight_cliques);
 }
 
-std::string debug(const std::bitset<32>& bs) {
+std::string debug(const VarSet& bs) {
     std::string s;
-    for(uint v = 0; v < 32; v++) {
+    for(uint v = 0; v < VARIABLES; v++) {
         if(!bs.test(v)) continue;
         if(s != "") s += ", ";
         s += to_string(v);
@@ -146,17 +166,21 @@ std::string debug(const std::bitset<32>& bs) {
     return s;
 }
 
-#define ULTRA_TIGHT 0
-
 Score MarkovBounder::tight_upperbound(size_t max_depth, Score lb) {
     if(max_depth > N - state.assign_mask.count())
         max_depth = N - state.assign_mask.count();
 
-    Cliques cliques[N];
+    if(++generation == 0) {
+        for(Seen& entry: seen)
+            entry.generation = 0;
+        generation = 1;
+    }
+    
     for(uint var = 0; var < N; var++) {
         if(state.contains(var))
             continue;
         
+        cliques[var].clear();
         construct_naive_cliques(cliques[var]);
         if(!ULTRA_TIGHT) continue;
         
@@ -170,12 +194,11 @@ Score MarkovBounder::tight_upperbound(size_t max_depth, Score lb) {
         }
     }
     
-    seen.clear();
-    return state.score + upperbound(cliques, state.assign_mask, max_depth, state.score, lb);
+    return state.score + upperbound(cliques.data(), state.assign_mask, max_depth, state.score, lb);
 }
 
 Network MarkovBounder::upperbound_solution() {
-    ArcMatrix matrix(N, std::bitset<32>());
+    ArcMatrix matrix(N, VarSet());
     for(uint var = 0; var < N; var++) {
         if(!state.contains(var))
             continue;
@@ -188,22 +211,9 @@ Network MarkovBounder::upperbound_solution() {
     return Network { matrix, state.score + bayes_solver.solve(state.assign_mask) };
 }
 
-Network MarkovBounder::lowerbound_solution(size_t branching) {
+Network MarkovBounder::lowerbound_solution(size_t branching, uint threads) {
     Network ub = upperbound_solution();
-    return Moralizer(instance, N).moralize(ub.matrix, branching);
-}
-
-bool MarkovBounder::has_path_to(uint source, uint target, std::bitset<32>& has_path, std::bitset<32>& no_path) {
-    if(source == target || has_path.test(source)) return true;
-    if(no_path.test(source)) return false;
-    
-    for(uint parent: instance.domains[source][state[source].parentset].list)
-        if(has_path_to(parent, target, has_path, no_path)) {
-            has_path.set(source);
-			return true;
-		}
-    no_path.set(source);
-    return false;
+    return Moralizer(instance, N, threads).moralize(ub.matrix, branching);
 }
 
 void MarkovBounder::find_bad_cliques(uint var, Cliques& bad_cliques) {
@@ -211,13 +221,11 @@ void MarkovBounder::find_bad_cliques(uint var, Cliques& bad_cliques) {
         if(!state.contains(target) || target < var)
             continue;
         
-        std::bitset<32> has_path, no_path;
         for(uint source = 0; source < N; source++) {
-            if(!state.contains(source) || (target != source &&
-                    !has_path_to(source, target, has_path, no_path)))
+            if(!state.contains(source) || !has_path_to(source, target))
                 continue;
             
-            std::bitset<32> subset = instance.domains[target][state[target].parentset].content;
+            VarSet subset = instance.domains[target][state[target].parentset].content;
             subset.set(target);
             bad_cliques.push_back(subset);
         }
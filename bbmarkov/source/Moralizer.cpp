@@ -1,126 +1,193 @@
 #include <Moralizer.hpp>
+#include <algorithm>
+#include <thread>
 #include <debug.hpp>
 
 #define N max_var
 
-Moralizer::Moralizer(Instance& i, uint mv):
+Moralizer::Moralizer(Instance& i, uint mv, uint t):
     instance(i),
-    max_var(mv) {}
+    max_var(mv),
+    threads(t? t: 1) {}
 
-std::bitset<32> Moralizer::parentset_of(const ArcMatrix& graph, uint var) {
-    std::bitset<32> content = graph[var];
+VarSet Moralizer::parentset_of(const ArcMatrix& graph, uint var) {
+    VarSet content = graph[var];
     content[var] = false;
     return content;
 }
 
-void Moralizer::consider_edge_addition(Queue& queue, Network network, uint source, uint target) {
-    std::bitset<32> pset = parentset_of(network.matrix, target);
-    network.score -= instance.domains[target][instance.domain_lookup[target].at(pset)].score;
+Score Moralizer::local_score(const ArcMatrix& graph, uint var) {
+    return instance.domains[var][instance.domain_lookup[var].at(parentset_of(graph, var))].score;
+}
+
+void Moralizer::add_to_closure(ArcMatrix& closure, uint source, uint target) {
+    VarSet reached = closure[source];
+    reached[source] = true;
     
-    network.matrix[target][source] = true;
-    if(network.is_within_cycle(source))
-        return;
+    closure[target] |= reached;
+    for(uint var = 0; var < N; var++)
+        if(closure[var][target])
+            closure[var] |= reached;
+}
+
+void Moralizer::consider_edge_addition(Edits& edits, Network& network, const ArcMatrix& closure,
+        uint source, uint target) {
     
-    pset = parentset_of(network.matrix, target);
-    if(pset.count() > instance.max_pset)
+    if(closure[source][target])
         return;
     
-    network.score += instance.domains[target][instance.domain_lookup[target].at(pset)].score;
-    queue.push(network);
+    Score score = network.score - local_score(network.matrix, target);
+    
+    network.matrix[target][source] = true;
+    bool valid = parentset_of(network.matrix, target).count() <= instance.max_pset;
+    if(valid)
+        score += local_score(network.matrix, target);
+    network.matrix[target][source] = false;
+    
+    if(valid)
+        edits.push_back(Edit {score, target, source});
 }
 
-void Moralizer::consider_edge_removal(Queue& queue, Network network, uint child, uint parent) {
-    std::bitset<32> pset = parentset_of(network.matrix, child);
-    network.score -= instance.domains[child][instance.domain_lookup[child].at(pset)].score;
+void Moralizer::consider_edge_removal(Edits& edits, Network& network, uint child, uint parent) {
+    Score score = network.score - local_score(network.matrix, child);
     
     network.matrix[child][parent] = false;
-    pset = parentset_of(network.matrix, child);
-    network.score += instance.domains[child][instance.domain_lookup[child].at(pset)].score;
-    queue.push(network);
+    score += local_score(network.matrix, child);
+    network.matrix[child][parent] = true;
+    
+    edits.push_back(Edit {score, child, parent});
 }
 
-size_t Moralizer::find_immoralities(Queue& queue, const Network& network, Direction direction) {
+size_t Moralizer::find_immoralities(Edits& edits, Network& network, const ArcMatrix& closure,
+        Direction direction) {
 
-    size_t count = 0;
-    std::unordered_set<size_t> pairs;
-    for(uint var = 0; var < N; var++) {
-        for(uint p1 = 0; p1 < N; p1++) {
-            if(!network.matrix[var][p1] || var == p1) continue;
-            
-            for(uint p2 = 0; p2 < p1; p2++) {
-                if(!network.matrix[var][p2] || var == p2) continue;
-                if(network.matrix[p1][p2] || network.matrix[p2][p1]) continue;
-                if(pairs.find(p1 + p2 * N) != pairs.end()) continue;
-                
-                pairs.insert(p1 + p2 * N);
-
-                if(direction == AddEdges) {
-                    consider_edge_addition(queue, network, p1, p2);
-                    consider_edge_addition(queue, network, p2, p1);
+    ArcMatrix pairs;
+    size_t count = find_immoral_pairs(network.matrix, pairs);
+    if(direction == AddEdges)
+        for(uint p1 = 0; p1 < N; p1++)
+            for(uint word = 0; word * 64 < p1; word++)
+                for(uint64_t bits = set_word(pairs[p1], word); bits; bits &= bits - 1) {
+                    uint p2 = word * 64 + __builtin_ctzll(bits);
+                    consider_edge_addition(edits, network, closure, p1, p2);
+                    consider_edge_addition(edits, network, closure, p2, p1);
                 }
-                count++;
-            }
-        }
-    }
     
     if(direction == RemoveEdges)
         for(uint var = 0; var < N; var++)
             for(uint p = 0; p < N; p++)
                 if(network.matrix[var][p] && var != p)
-                    consider_edge_removal(queue, network, var, p);
+                    consider_edge_removal(edits, network, var, p);
     return count;
 }
 
-void Moralizer::clear_candidates(Queue& queue, size_t accuracy) {
-    if(accuracy >= queue.size())
-        return;
-    std::priority_queue<Network> best;
-    while(!queue.empty()) {
-        if(best.size() < accuracy)
-            best.push(queue.top());
-        queue.pop();
+void Moralizer::select_candidates(Edits& edits, size_t accuracy) {
+    if(accuracy < edits.size()) {
+        std::partial_sort(edits.begin(), edits.begin() + accuracy, edits.end());
+        edits.resize(accuracy);
+    } else
+        std::sort(edits.begin(), edits.end());
+}
+
+void Moralizer::expand(Search& search, Network& network, uint64_t hash,
+        size_t depth, const Edit& edit) {
+    
+    if(search.direction == AddEdges) {
+        if(search.closures.size() <= depth)
+            search.closures.resize(depth + 1);
+        search.closures[depth] = search.closures[depth - 1];
+        add_to_closure(search.closures[depth], edit.parent, edit.child);
     }
-    queue.swap(best);
+    
+    Score score = network.score;
+    network.matrix[edit.child].flip(edit.parent);
+    network.score = edit.score;
+    
+    fix_global_immoralities(search, network, hash ^ arc_key(edit.child, edit.parent), depth);
+    
+    network.matrix[edit.child].flip(edit.parent);
+    network.score = score;
 }
 
-void Moralizer::fix_global_immoralities(const Network& network, Network& best,
-        Direction direction, size_t accuracy, size_t depth) {
+void Moralizer::fix_global_immoralities(Search& search, Network& network,
+        uint64_t hash, size_t depth) {
     
-    if(network.score <= best.score || visited.find(network.matrix) != visited.end())
+    if(network.score <= search.best.score || !search.visited.insert(hash).second)
         return;
-    visited.insert(network.matrix);
 
-    Queue queue;
-    if(!find_immoralities(queue, network, direction)) {
-        if(best.score < network.score)
-            best = network;
+    const ArcMatrix& closure = search.closures[search.direction == AddEdges? depth: 0];
+    Edits candidates;
+    if(!find_immoralities(candidates, network, closure, search.direction)) {
+        search.best = network;
         return;
     }
-    clear_candidates(queue, depth >= 2? 1: accuracy);
+    select_candidates(candidates, depth >= 2? 1: search.accuracy);
 
-    while(!queue.empty()) {
-        fix_global_immoralities(queue.top(), best, direction, accuracy, depth + 1);
-        queue.pop();
-    }
+    for(const Edit& edit: candidates)
+        expand(search, network, hash, depth + 1, edit);
 }
 
-Network Moralizer::moralize(const ArcMatrix& graph, Direction direction, size_t accuracy) {
+// The candidates of the input network are divided among the budgeted threads, each
+// of which searches below its share with its own visited states.
+Network Moralizer::moralize(const ArcMatrix& graph, Direction direction, size_t accuracy,
+        uint budget) {
     Score score = 0;
+    uint64_t hash = 0;
     for(uint var = 0; var < N; var++) {
-        size_t pset = instance.domain_lookup[var].at(parentset_of(graph, var));
-        score += instance.domains[var][pset].score;
+        score += local_score(graph, var);
+        for(uint parent = 0; parent < N; parent++)
+            if(graph[var][parent])
+                hash ^= arc_key(var, parent);
     }
     
-    Network best { ArcMatrix(), -INF };
-    visited.clear();
-    fix_global_immoralities(Network {graph, score},
-        best, direction, accuracy, 0);
+    Network network {graph, score};
+    ArcMatrix closure;
+    if(direction == AddEdges)
+        closure = transitive_closure(graph);
+    
+    Edits candidates;
+    if(!find_immoralities(candidates, network, closure, direction))
+        return network;
+    select_candidates(candidates, accuracy);
+    
+    uint workers = std::max(size_t(1), std::min(size_t(budget), candidates.size()));
+    std::vector<Search> searches(workers, Search(direction, accuracy));
+    
+    auto work = [&](uint worker) {
+        Network copy = network;
+        searches[worker].closures.assign(1, closure);
+        searches[worker].visited.insert(hash);
+        for(size_t i = worker; i < candidates.size(); i += workers)
+            expand(searches[worker], copy, hash, 1, candidates[i]);
+    };
+    
+    std::vector<std::thread> pool;
+    for(uint w = 1; w < workers; w++)
+        pool.push_back(std::thread(work, w));
+    work(0);
+    for(std::thread& thread: pool)
+        thread.join();
+    
+    Network best = searches[0].best;
+    for(uint w = 1; w < workers; w++)
+        if(best.score < searches[w].best.score)
+            best = searches[w].best;
     return best;
 }
 
+// With more than one thread, both directions are searched at once and share them.
 Network Moralizer::moralize(const ArcMatrix& graph, size_t accuracy) {
-    Network filled = moralize(graph, Moralizer::AddEdges, accuracy);
-    Network reduced = moralize(graph, Moralizer::RemoveEdges, accuracy);
+    if(threads == 1) {
+        Network filled = moralize(graph, Moralizer::AddEdges, accuracy, 1);
+        Network reduced = moralize(graph, Moralizer::RemoveEdges, accuracy, 1);
+        return filled.score > reduced.score? filled: reduced;
+    }
+    
+    Network filled { ArcMatrix(), -INF };
+    std::thread adder([&]() {
+        filled = moralize(graph, Moralizer::AddEdges, accuracy, threads - threads / 2);
+    });
+    Network reduced = moralize(graph, Moralizer::RemoveEdges, accuracy, threads / 2);
+    adder.join();
 
     return filled.score > reduced.score? filled: reduced;
-}
\ No newline at end of file
+}
@@ -1,62 +1,135 @@
 #include <Network.hpp>
+#include <cstring>
+#include <sstream>
 
 bool Network::operator<(const Network& another) const {
     return score < another.score;
 }
 
-bool Network::has_path_between(uint var, uint target, std::bitset<32>& visited) {
-    if(visited[var])
-        return false;
-    visited[var] = true;
-    for(uint v = 0; v < matrix.size(); v++) {
-        if(var == v || !matrix[var][v])
-            continue;
-        if(v == target || has_path_between(v, target, visited))
-            return true;
+// Row v of the closure holds every proper ancestor of v.
+ArcMatrix transitive_closure(const ArcMatrix& graph) {
+    ArcMatrix closure(graph);
+    for(uint var = 0; var < graph.size(); var++)
+        closure[var].reset(var);
+    
+    for(bool changed = true; changed; ) {
+        changed = false;
+        for(uint var = 0; var < graph.size(); var++) {
+            VarSet reached = closure[var];
+            for(uint p = 0; p < graph.size(); p++)
+                if(closure[var][p])
+                    reached |= closure[p];
+            if(reached != closure[var]) {
+                closure[var] = reached;
+                changed = true;
+            }
+        }
     }
-    return false;
+    return closure;
 }
 
-bool Network::is_within_cycle(uint var) {
-    std::bitset<32> visited;
-    return has_path_between(var, var, visited);
+// Row p of the result holds every q < p that shares a child with p without
+// being adjacent to it. Each child contributes its parent mask minus the
+// neighbours of one parent at a time, so the work is whole-word set operations.
+size_t find_immoral_pairs(const ArcMatrix& graph, ArcMatrix& pairs) {
+    uint n = graph.size();
+    ArcMatrix adjacent(graph);
+    for(uint var = 0; var < n; var++)
+        for(uint word = 0; word * 64 < n; word++)
+            for(uint64_t bits = set_word(graph[var], word); bits; bits &= bits - 1)
+                adjacent[word * 64 + __builtin_ctzll(bits)].set(var);
+    
+    pairs.assign(n, VarSet());
+    for(uint var = 0; var < n; var++) {
+        VarSet parents = graph[var];
+        parents.reset(var);
+        for(uint word = 0; word * 64 < n; word++)
+            for(uint64_t bits = set_word(parents, word); bits; bits &= bits - 1) {
+                uint p = word * 64 + __builtin_ctzll(bits);
+                pairs[p] |= parents & ~adjacent[p] & full_set(p);
+            }
+    }
+    
+    size_t count = 0;
+    for(uint var = 0; var < n; var++)
+        count += pairs[var].count();
+    return count;
 }
 
 size_t Network::count_immoralities() const {
+    ArcMatrix pairs;
+    return find_immoral_pairs(matrix, pairs);
+}
 
-    ArcMatrix unsatisfied(matrix.size(), std::bitset<32>());
-    for(uint var = 0; var < matrix.size(); var++)
-        for(uint parent = 0; parent < matrix.size(); parent++)
-            if(var != parent && matrix[var][parent])
-                unsatisfied[parent] |= matrix[var];
+// Every line lists vertices that are pairwise adjacent, so both edge lists and
+// clique lists can be read. Punctuation such as "0 -- 1", "0 -> 1" or "{0, 1, 2}"
+// is skipped, and '#' starts a comment.
+bool read_undirected_network(const std::string& fname, uint n, ArcMatrix& graph,
+        std::string& error) {
     
-    for(uint var = 0; var < matrix.size(); var++) {
-        unsatisfied[var][var] = false;
-        for(uint var2 = 0; var2 < var; var2++) {
-            if(!matrix[var][var2] && !matrix[var2][var])
-                continue;
-            unsatisfied[var][var2] = false;
-            unsatisfied[var2][var] = false;
-        }
+    std::ifstream input(fname);
+    if(!input.is_open()) {
+        error = "couldn't open it";
+        return false;
     }
     
-    size_t count = 0;
-    for(uint var = 0; var < matrix.size(); var++)
-        count += unsatisfied[var].count();
-    return count / 2;
-}
-
-size_t NetworkHash::operator()(const ArcMatrix& skeleton) const {
-    size_t hash = 0;
-    for(const std::bitset<32>& bitset: skeleton)
-        hash = hash * 31 + bitset.to_ulong();
-    return hash;
+    graph.assign(n, VarSet());
+    std::string line;
+    for(size_t number = 1; std::getline(input, line); number++) {
+        line = line.substr(0, line.find('#'));
+        for(char& c: line) {
+            if(std::strchr(",;:{}[]()<>-=|\t\r", c))
+                c = ' ';
+            else if(c != ' ' && (c < '0' || c > '9')) {
+                error = format("unexpected '%' on line %", c, number);
+                return false;
+            }
+        }
+        
+        std::istringstream stream(line);
+        std::vector<uint> clique;
+        for(size_t var; stream >> var; clique.push_back(var))
+            if(var >= n) {
+                error = format("vertex % on line % is out of range", var, number);
+                return false;
+            }
+        
+        for(uint a: clique)
+            for(uint b: clique)
+                if(a != b)
+                    graph[a].set(b);
+    }
+    return true;
 }
 
-bool NetworkCompare::operator()(const ArcMatrix& a, const ArcMatrix& b) const {
-    assert(a.size() == b.size());
-    for(size_t i = 0; i < a.size(); i++)
-        if(a[i] != b[i])
-            return false;
+// Maximum cardinality search from the given vertex. The graph is chordal exactly
+// when the earlier neighbours of each vertex are adjacent to each other, which
+// makes the order perfect.
+bool perfect_ordering(const ArcMatrix& graph, uint first, std::vector<uint>& order) {
+    uint n = graph.size();
+    std::vector<uint> weights(n, 0);
+    VarSet visited;
+    
+    order.clear();
+    for(uint step = 0; step < n; step++) {
+        uint var = first;
+        if(step) {
+            var = n;
+            for(uint v = 0; v < n; v++)
+                if(!visited[v] && (var == n || weights[var] < weights[v]))
+                    var = v;
+        }
+        
+        VarSet earlier = graph[var] & visited;
+        for(uint p = 0; p < n; p++)
+            if(earlier[p] && (earlier & ~graph[p]).count() > 1)
+                return false;
+        
+        order.push_back(var);
+        visited.set(var);
+        for(uint v = 0; v < n; v++)
+            if(graph[var][v])
+                weights[v]++;
+    }
     return true;
 }
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include <ParallelSolver.hpp>
+#include <thread>
+
+ParallelSolver::ParallelSolver(const Settings& s, Instance& i, uint mv):
+    N(mv),
+    settings(s),
+    instance(i),
+    context(i, mv),
+    pool(s.threads) {
+    
+    for(uint w = 0; w < settings.threads; w++) {
+        workers.push_back(std::unique_ptr<Solver>(
+            new Solver(settings, instance, N, &context)));
+        workers.back()->attach(&pool, w);
+    }
+}
+
+const Solution& ParallelSolver::solution() const {
+    return workers[0]->solution();
+}
+
+void ParallelSolver::work(uint worker) {
+    Task task;
+    while(pool.take(worker, task)) {
+        workers[worker]->run(task);
+        pool.finish();
+    }
+}
+
+void ParallelSolver::solve() {
+    if(workers[0]->initialize()) {
+        for(uint w = 1; w < workers.size(); w++)
+            workers[w]->fix_source_vertex();
+        
+        pool.push(0, Task());
+        
+        std::vector<std::thread> threads;
+        for(uint w = 1; w < workers.size(); w++)
+            threads.push_back(std::thread(&ParallelSolver::work, this, w));
+        work(0);
+        
+        for(std::thread& thread: threads)
+            thread.join();
+        for(uint w = 1; w < workers.size(); w++)
+            workers[0]->merge_statistics(* workers[w]);
+    }
+    workers[0]->finish();
+}
@@ -3,17 +3,6 @@
 #include <algorithm>
 #include <set>
 
-void initialize_lookup_table(std::vector<DomainLookup>& domain_lookup, const Domains& domains) {
-    domain_lookup.reserve(domains.size());
-    
-    for(uint var = 0; var < domains.size(); var++) {
-        domain_lookup.push_back(DomainLookup());
-        
-        for(size_t pset = 0; pset < domains[var].size(); pset++)
-            domain_lookup[var].insert(std::make_pair(domains[var][pset].content, pset));
-    }
-}
-
 void read_parents(std::istream& input, ParentSet& parents) {
     size_t count = read(input);
     for(size_t i = 0; i < count; i++)
@@ -44,6 +33,8 @@ void read_cussen_scores(std::istream& input, Domains& data) {
     
     for(size_t i = 0; i < count; i++)
         data.push_back(Domain());
+    if(count > VARIABLES)
+        return;
     
     for(size_t i = 0; i < count; i++)
         read_parentsets(input, data);
@@ -0,0 +1,40 @@
+#include <Profile.hpp>
+#include <fstream>
+#include <unistd.h>
+
+const char * Profile::section_names[Profile::Sections] = {
+    "fast UB", "tight UB", "option lists", "memo lookups", "moralizer"
+};
+
+const char * Profile::prune_names[Profile::Prunes] = {
+    "bottom", "UB", "tight UB", "options", "raised LB"
+};
+
+Profile::Profile(uint layers):
+    enabled(false),
+    prunes(size_t(layers) * Prunes, 0) {
+    
+    for(uint i = 0; i < Sections; i++)
+        nanoseconds[i] = calls[i] = 0;
+    for(uint i = 0; i < Buckets; i++)
+        list_sizes[i] = 0;
+}
+
+void Profile::merge(const Profile& other) {
+    for(uint i = 0; i < Sections; i++) {
+        nanoseconds[i] += other.nanoseconds[i];
+        calls[i] += other.calls[i];
+    }
+    for(size_t i = 0; i < prunes.size(); i++)
+        prunes[i] += other.prunes[i];
+    for(uint i = 0; i < Buckets; i++)
+        list_sizes[i] += other.list_sizes[i];
+}
+
+size_t resident_memory() {
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    if(!(statm >> pages >> resident))
+        return 0;
+    return resident * sysconf(_SC_PAGESIZE);
+}
@@ -0,0 +1,133 @@
+#include <ScoreFile.hpp>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+// Layout: a header, a directory with one (offset, count) pair per variable and one
+// section per variable. A section holds the score-sorted domain as scores and packed
+// parent masks, followed by the domain indices sorted by their masks.
+
+struct ScoreHeader {
+    char magic[8];
+    uint32_t version, variables, words, reserved;
+};
+
+struct ScoreDirectory {
+    uint64_t offset, count;
+};
+
+static const char * score_magic = "BBMSCORE";
+
+inline size_t padded(size_t bytes) {
+    return (bytes + 7) & ~size_t(7);
+}
+
+inline size_t section_size(size_t count, uint words) {
+    return count * (sizeof(double) + words * sizeof(uint64_t)) +
+        padded(count * sizeof(uint32_t));
+}
+
+bool is_binary_scores(const MappedFile& file) {
+    return file.size() >= sizeof(ScoreHeader) &&
+        !std::memcmp(file.data(), score_magic, 8);
+}
+
+// Every count, offset, mask bit and order index is checked against the file and the
+// header before it's used, so a truncated or corrupt file is rejected.
+bool read_binary_scores(const MappedFile& file, Domains& domains,
+        std::vector<DomainLookup>& domain_lookup) {
+    
+    if(file.size() < sizeof(ScoreHeader))
+        return false;
+    const ScoreHeader& header = * (const ScoreHeader *) file.data();
+    if(header.version != 1 || header.words != (header.variables + 63) / 64)
+        return false;
+    
+    const ScoreDirectory * directory = (const ScoreDirectory *)
+        (file.data() + sizeof(ScoreHeader));
+    if(header.variables > (file.size() - sizeof(ScoreHeader)) / sizeof(ScoreDirectory))
+        return false;
+    
+    domains.assign(header.variables, Domain());
+    if(header.variables > VARIABLES)
+        return true;
+    
+    domain_lookup.assign(header.variables, DomainLookup());
+    for(uint var = 0; var < header.variables; var++) {
+        size_t count = directory[var].count, offset = directory[var].offset;
+        if(count > file.size() / sizeof(double) || offset > file.size() || offset % 8 ||
+                section_size(count, header.words) > file.size() - offset)
+            return false;
+        
+        const char * section = file.data() + offset;
+        const double * scores = (const double *) section;
+        const uint64_t * masks = (const uint64_t *) (scores + count);
+        const uint32_t * order = (const uint32_t *) (masks + count * header.words);
+        
+        Domain& domain = domains[var];
+        domain.reserve(count);
+        for(size_t pset = 0; pset < count; pset++) {
+            domain.push_back(ParentSet(scores[pset]));
+            for(uint word = 0; word < header.words; word++)
+                for(uint64_t bits = masks[pset * header.words + word]; bits; bits &= bits - 1) {
+                    uint parent = word * 64 + __builtin_ctzll(bits);
+                    if(parent >= header.variables || parent == var)
+                        return false;
+                    domain.back().add(parent);
+                }
+        }
+        
+        for(size_t i = 0; i < count; i++)
+            if(order[i] >= count || (i > 0 &&
+                    !mask_less(domain[order[i - 1]].content, domain[order[i]].content)))
+                return false;
+        
+        domain_lookup[var].build(domain, header.variables, order);
+    }
+    return true;
+}
+
+bool write_binary_scores(const std::string& fname, const Domains& domains) {
+    std::ofstream output(fname, std::ios::binary);
+    if(!output.is_open())
+        return false;
+    
+    ScoreHeader header;
+    std::memcpy(header.magic, score_magic, 8);
+    header.version = 1;
+    header.variables = domains.size();
+    header.words = (domains.size() + 63) / 64;
+    header.reserved = 0;
+    
+    std::vector<ScoreDirectory> directory;
+    size_t offset = sizeof(ScoreHeader) + domains.size() * sizeof(ScoreDirectory);
+    for(const Domain& domain: domains) {
+        directory.push_back(ScoreDirectory { offset, domain.size() });
+        offset += section_size(domain.size(), header.words);
+    }
+    
+    output.write((const char *) &header, sizeof(header));
+    output.write((const char *) directory.data(), directory.size() * sizeof(ScoreDirectory));
+    
+    for(const Domain& domain: domains) {
+        for(const ParentSet& parentset: domain)
+            output.write((const char *) &parentset.score, sizeof(double));
+        
+        for(const ParentSet& parentset: domain)
+            for(uint word = 0; word < header.words; word++) {
+                uint64_t bits = set_word(parentset.content, word);
+                output.write((const char *) &bits, sizeof(bits));
+            }
+        
+        std::vector<uint32_t> order(domain.size());
+        for(size_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return mask_less(domain[a].content, domain[b].content);
+        });
+        
+        order.resize(padded(order.size() * sizeof(uint32_t)) / sizeof(uint32_t), 0);
+        output.write((const char *) order.data(), order.size() * sizeof(uint32_t));
+    }
+    return output.good();
+}
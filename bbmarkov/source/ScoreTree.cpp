@@ -1,32 +1,90 @@
 #include <ScoreTree.hpp>
 
-ScoreTree::ScoreTree(uint size):
-N(size), sequences(size_t(1) << N, INF) {}
+ScoreTree::Mode ScoreTree::choose_mode(uint N, size_t domain_size, size_t budget) {
+    size_t width = domain_size < 0xffff? sizeof(uint16_t): sizeof(uint32_t);
+    if(N >= MAX_DENSE_VARIABLES || (size_t(N) << N) * width > budget)
+        return Sparse;
+    return width == sizeof(uint16_t)? Narrow: Wide;
+}
 
-void ScoreTree::construct(const Domain& d, const DomainLookup& dl) {
-    domain = &d;
-    domain_lookup = &dl;
+ScoreTree::ScoreTree(uint size, Mode m):
+N(size), id(0), mode(m), domain(nullptr) {}
 
-    sequences[0] = domain_lookup->at(0);
-    construct(full_set(N));
+// Prepares the tree for another domain. The table of the mode in use keeps its
+// capacity, so trees of the same size are rebuilt without allocating.
+void ScoreTree::reset(uint size, Mode m) {
+    N = size;
+    mode = m;
+    domain = nullptr;
+    masks.clear();
+    if(mode != Narrow)
+        std::vector<uint16_t>().swap(narrow);
+    if(mode != Wide)
+        std::vector<uint32_t>().swap(wide);
 }
 
-size_t ScoreTree::construct(std::bitset<32> subset) {
-    size_t& current = sequences[subset.to_ulong()];
-    if(current != INF)
-        return current;
+template<typename Index>
+void propagate(std::vector<Index>& best, const Domain& domain, uint N) {
+    const Index none = Index(-1);
+    best.assign(size_t(1) << N, none);
     
-    if(domain_lookup->find(subset) != domain_lookup->end())
-        current = domain_lookup->at(subset);
+    for(size_t pset = 0; pset < domain.size(); pset++)
+        best[domain[pset].content.to_ulong()] = pset;
     
-    for(uint var = 0; var < N; var++) {
-        if(!subset.test(var))
-            continue;
-        subset.reset(var);
-        size_t pset = construct(subset);
-        if(current == INF || (* domain)[current].score < (* domain)[pset].score)
-            current = pset;
-        subset.set(var);
+    for(size_t subset = 1; subset < best.size(); subset++) {
+        Index current = best[subset];
+        for(uint var = 0; var < N; var++) {
+            if(!(subset & (size_t(1) << var)))
+                continue;
+            Index pset = best[subset ^ (size_t(1) << var)];
+            if(current == none || domain[current].score < domain[pset].score)
+                current = pset;
+        }
+        best[subset] = current;
     }
-    return current;
-}
\ No newline at end of file
+}
+
+void ScoreTree::construct(const Domain& d) {
+    domain = &d;
+    id = ++trees;
+    
+    if(mode == Narrow)
+        propagate(narrow, * domain, N);
+    else if(mode == Wide)
+        propagate(wide, * domain, N);
+    else {
+        masks.reserve(domain->size());
+        for(const ParentSet& parentset: * domain)
+            masks.push_back(parentset.content);
+    }
+}
+
+thread_local ScoreTree::CacheEntry ScoreTree::cache[ScoreTree::CacheSize];
+std::atomic<uint64_t> ScoreTree::trees(0);
+
+size_t ScoreTree::scan(const VarSet& subset) const {
+    VarSet outside = ~subset;
+    for(size_t pset = 0; pset < masks.size(); pset++)
+        if((masks[pset] & outside).none())
+            return pset;
+    return masks.size() - 1;
+}
+
+size_t ScoreTree::find(const VarSet& subset) const {
+    size_t hash = std::hash<VarSet>()(subset) ^ id;
+    CacheEntry& entry = cache[(hash * 0x9E3779B97F4A7C15ull >> 32) % CacheSize];
+    
+    if(entry.tree == id && entry.subset == subset)
+        return entry.pset;
+    
+    entry.tree = id;
+    entry.subset = subset;
+    entry.pset = scan(subset);
+    return entry.pset;
+}
+
+size_t ScoreTree::memory() const {
+    return narrow.capacity() * sizeof(uint16_t) +
+        wide.capacity() * sizeof(uint32_t) +
+        masks.capacity() * sizeof(VarSet);
+}
@@ -116,8 +116,14 @@ void Solution::print(const Domains& domains) const {
 
 void Solution::set_parents(uint var, const ParentSet& parents) {
     assign_mask.set(var, true);
+    if(!skeleton[var][var])
+        hash ^= skeleton_key(var, var);
     skeleton[var][var] = true;
+    ancestors[var] = ancestors_of(parents);
+    ancestors[var].set(var);
     for(uint i = 0; i < parents.list.size(); i++) {
+        if(!skeleton[var][parents[i]] && !skeleton[parents[i]][var])
+            hash ^= skeleton_key(var, parents[i]);
         skeleton[var][parents[i]] = true;
         skeleton[parents[i]][var] = true;
     }
@@ -125,9 +131,13 @@ void Solution::set_parents(uint var, const ParentSet& parents) {
 
 void Solution::reset_parents(uint var) {
     assign_mask.set(var, false);
-    skeleton[var].reset();
-    for(uint v = 0; v < N; v++)
+    for(uint v = 0; v < N; v++) {
+        if(skeleton[var][v] || skeleton[v][var])
+            hash ^= skeleton_key(var, v);
         skeleton[v][var] = false;
+    }
+    skeleton[var].reset();
+    ancestors[var].reset();
 }
 
 size_t calculate_depth(const ArcMatrix& matrix, Solution& solution, uint var) {
@@ -158,13 +168,14 @@ const Network& network) {
         layers[depth].push_back(var);
     }
     
-    for(uint var = 0; var < network.matrix.size(); var++) {
-        std::bitset<32> bitset = network.matrix[var];
-        bitset.reset(var);
+    for(uint depth = 0; depth <= domains.size(); depth++)
+        for(uint var: layers[depth]) {
+            VarSet bitset = network.matrix[var];
+            bitset.reset(var);
 
-        solution[var].parentset = domain_lookup[var].at(bitset);
-        solution.set_parents(var, domains[var][solution[var].parentset]);
-    }
+            solution[var].parentset = domain_lookup[var].at(bitset);
+            solution.set_parents(var, domains[var][solution[var].parentset]);
+        }
     return solution;
 }
 
@@ -181,7 +192,10 @@ void add_symbol(std::string& string, size_t i) {
 }
 
 std::string Solution::fingerprint() const {
-    size_t hash = NetworkHash()(skeleton);
+    size_t hash = 0;
+    for(const VarSet& bitset: skeleton)
+        for(uint word = 0; word * 64 < VARIABLES; word++)
+            hash = hash * 31 + set_word(bitset, word);
 
     size_t multiplier = 1;
     while(multiplier * symbols <= hash && multiplier < multiplier * symbols)
@@ -7,14 +7,57 @@
 #define max(a, b) ((a) > (b)? (a): (b))
 #define min(a, b) ((a) < (b)? (a): (b))
 
-Solver::Solver(const std::bitset<32>& f, Instance& i, uint mv):
-    flags(f),
+#define MORALIZER_BEAM 30
+#define POLL_INTERVAL 4096
+
+// Recurring skeletons are only counted, so a small table is enough to find them.
+#define SKELETON_TABLE_BYTES (1 << 20)
+
+Solver::Solver(const Settings& s, Instance& i, uint mv, SearchContext * shared,
+        TranspositionTable * memo):
+    settings(s),
+    flags(s.flags),
     state(0, i.domains.size(), mv),
     lb_solution(-INF, i.domains.size(), mv),
-    bounds(state, i, mv),
-    stats {std::vector<size_t>(mv, 0), get_time(), 0, 0, 0, 0, -INF, INF},
+    own_context(shared? nullptr: new SearchContext(i, mv)),
+    context(shared? * shared: * own_context),
+    incumbent(context.incumbent),
+    bayes_solver(context.bayes_solver),
+    pool(nullptr),
+    worker(0),
+    root_order(0),
+    option_buffers(mv),
+    bound_buffers(mv),
+    bounds(state, i, bayes_solver, mv),
+    stats {std::vector<size_t>(mv, 0), get_time(), 0, 0, 0, 0, 0, -INF, INF, 0, 0, 0, 0, 0, 0,
+        TranspositionTable::Counters {0, 0, 0, 0},
+        std::vector<size_t>(mv, 0), 0, 0, Profile(mv)},
     instance(i),
-    N(mv) {}
+    N(mv) {
+    
+    if(memo)
+        option_memo.swap(* memo);
+    if(flags[MemoizeOptions])
+        option_memo.allocate((settings.memo_mb << 20) / settings.threads);
+    if(flags[MemoizeSkeletons])
+        skeleton_memo.allocate(SKELETON_TABLE_BYTES);
+    stats.profile.enabled = settings.profile;
+    positions.assign(N, 0);
+    poll_countdown = 0;
+    next_checkpoint = next_progress = 0;
+    reported_visits = progress_visits = progress_time = 0;
+    global_ub = INF;
+}
+
+void Statistics::merge(const Statistics& other) {
+    for(size_t i = 0; i < layer_visits.size(); i++)
+        layer_visits[i] += other.layer_visits[i];
+    recurring_skeletons += other.recurring_skeletons;
+    option_hits += other.option_hits;
+    tight_UBs += other.tight_UBs;
+    successful_tight_UBs += other.successful_tight_UBs;
+    profile.merge(other.profile);
+}
 
 const Solution& Solver::solution() const {
     return lb_solution;
@@ -34,6 +77,8 @@ std::string formatted_time(size_t time) {
 }
 
 void Solver::output_lowerbound(const std::string& title) {
+    if(settings.silent)
+        return;
     if(flags[MinVerbosity]) {
         std::cout << stats.time() << "\t"
             << to_string(lb_solution.score) << "\t"
@@ -57,206 +102,630 @@ Score Solver::generate_lowerbound() {
         std::cout << std::endl;
     }
     
-    if(lb_solution.score != -INF)
+    if(lowerbound() != -INF) {
+        lb_solution = incumbent.solution();
         output_lowerbound("Initial LB");
-
-    Network network = bounds.lowerbound_solution(10);
-    if(network.score > lb_solution.score) {
-        lb_solution = Solution::construct(instance.domains, instance.domain_lookup, network);
+    }
+    if(settings.initial != "")
+        offer_initial_network();
+
+    Network network = [&]() {
+        ProfileTimer timer(stats.profile, Profile::Moralizer);
+        return bounds.lowerbound_solution(MORALIZER_BEAM, settings.threads);
+    }();
+    Solution moralized = Solution::construct(instance.domains, instance.domain_lookup, network);
+    incumbent.offer(moralized, [&]() {
+        lb_solution = moralized;
         output_lowerbound("Moralized Bayes");
+    });
+    return max(network.score, lowerbound());
+}
+
+// Directs the chordal network of --initial in the perfect ordering that scores
+// best and offers it as the incumbent.
+void Solver::offer_initial_network() {
+    ArcMatrix graph;
+    std::string error;
+    Network best(ArcMatrix(), -INF);
+    
+    if(read_undirected_network(settings.initial, N, graph, error)) {
+        std::vector<uint> order;
+        for(uint first = 0; first < N; first++) {
+            if(!perfect_ordering(graph, first, order)) {
+                error = "it isn't chordal";
+                break;
+            }
+            
+            ArcMatrix dag(N, VarSet());
+            VarSet placed;
+            Score score = 0;
+            for(uint var: order) {
+                dag[var] = graph[var] & placed;
+                size_t pset = instance.domain_lookup[var].find(dag[var]);
+                if(pset == DomainLookup::None) {
+                    score = -INF;
+                    break;
+                }
+                score += instance.domains[var][pset].score;
+                placed.set(var);
+            }
+            if(best.score < score)
+                best = Network(std::move(dag), score);
+        }
+        if(error == "" && best.score == -INF)
+            error = "some of its parent sets aren't in the scores";
+    }
+    
+    if(error != "") {
+        if(!settings.silent)
+            print("Ignoring the initial network '%': %.\n\n", settings.initial, error);
+        return;
     }
-    return network.score;
+    
+    Solution initial = Solution::construct(instance.domains, instance.domain_lookup, best);
+    incumbent.offer(initial, [&]() {
+        lb_solution = initial;
+        output_lowerbound("Initial network");
+    });
 }
 
-void Solver::solve() {
+void Solver::fix_source_vertex() {
     if(flags[FixedSourceVertex]) {
         state[0].depth = 0;
-        state[0].parentset = instance.domain_lookup[0][std::bitset<32>()];
+        state[0].parentset = instance.domain_lookup[0].at(VarSet());
 
         state.set_parents(0, instance.domains[0][state[0].parentset]);
         state.score = instance.domains[0][state[0].parentset].score;
         verbose("Fixed o_0 <- 0; p_0 <- []\n");
     }
+    root_order = state.assign_mask.count();
+    if(settings.progress_ms || settings.checkpoint != "")
+        poll_countdown = 1;
+}
+
+bool Solver::initialize() {
+    fix_source_vertex();
     
     if(!flags[MinVerbosity])
         print("Learning optimal BN structures... ");
-    stats.UB = bounds.fast_upperbound();
+    size_t start = get_time();
+    size_t budget = settings.bayes_mb << 20;
+    bool filled = settings.bayes_file != ""?
+        bayes_solver.fill(settings.threads, budget, settings.bayes_file):
+        bayes_solver.fill(settings.threads, budget);
+    stats.bayes_time = get_time() - start;
+    stats.UB = global_ub = bounds.fast_upperbound();
     if(!flags[MinVerbosity])
-        print("Done.\n\n");
+        print(filled? "Done.\n\n": "Too large; using relaxed bounds instead.\n\n");
     
     stats.LB = generate_lowerbound();
-    if(stats.LB < stats.UB)
-        solve(state.assign_mask.count());
+    if(flags[ImproveIncumbent] && stats.LB < stats.UB && lowerbound() != -INF) {
+        improver.reset(new LocalSearch(instance, incumbent, bounds.upperbound_solution(), N));
+        improver->start();
+    }
+    MappedFile::page_faults(stats.minor_faults, stats.major_faults);
+    stats.allocations = allocation_count();
+    return stats.LB < stats.UB;
+}
 
+void Solver::finish() {
+    if(improver) {
+        improver->stop();
+        stats.local_improvements = improver->improvements();
+    }
+    
+    size_t minor, major;
+    MappedFile::page_faults(minor, major);
+    stats.minor_faults = minor - stats.minor_faults;
+    stats.major_faults = major - stats.major_faults;
+    stats.allocations = allocation_count() - stats.allocations;
+    
+    lb_solution = incumbent.solution();
     output_lowerbound("Solution");
     if(!flags[MinVerbosity])
         output_statistics();
 }
 
+void Solver::solve() {
+    if(initialize()) {
+        if(flags[BestFirst])
+            best_first();
+        else {
+            if(settings.resume != "")
+                restore_checkpoint();
+            if(settings.checkpoint != "") {
+                catch_termination();
+                next_checkpoint = get_time() + settings.checkpoint_s * 1000;
+            }
+            solve(root_order);
+        }
+    }
+    finish();
+}
+
+void Solver::attach(TaskPool * p, uint w) {
+    pool = p;
+    worker = w;
+}
+
+void Solver::assign(size_t option) {
+    uint var = instance.option_var(option);
+    size_t pset = instance.option_pset(option);
+
+    state[var].parentset = pset;
+    state[var].depth = DomainBuilder::get_depth(state, instance.domains[var][pset]);
+    state.score += instance.domains[var][pset].score;
+
+    state.set_parents(var, instance.domains[var][pset]);
+    path.push_back(option);
+}
+
+void Solver::unassign(size_t option, Score original_score) {
+    state.score = original_score;
+    state.reset_parents(instance.option_var(option));
+    path.pop_back();
+}
+
+void Solver::run(const Task& task) {
+    Score original_score = state.score;
+    
+    for(size_t option: task.path)
+        assign(option);
+    
+    solve(root_order + task.path.size());
+    
+    for(size_t i = task.path.size(); i-- > 0;)
+        unassign(task.path[i], original_score);
+}
+
+void Solver::split(const OptionList& options) {
+    verbose("Splitting % options into tasks at depth %\n",
+        options.size(), path.size());
+    
+    for(auto it = options.rbegin(); it != options.rend(); it++) {
+        Task task { path };
+        task.path.push_back(it->option);
+        pool->push(worker, std::move(task));
+    }
+}
+
+void Solver::merge_statistics(const Solver& other) {
+    stats.merge(other.stats);
+    stats.merged_skeletons += other.skeleton_memo.size();
+    stats.merged_option_lists += other.option_memo.size();
+    stats.merged_memo.merge(other.option_memo.counters());
+}
+
+// The relaxed search of tight_upperbound() only finishes in time close to the
+// leaves, and only closes branches while the assigned part is sparse.
+bool Solver::tight_bound_pays_off(uint order) const {
+    if(N - order >= 10 || N - order <= 3)
+        return false;
+    
+    size_t edges = 0;
+    for(uint var = 0; var < N; var++)
+        if(state.contains(var))
+            edges += instance.domains[var][state[var].parentset].count();
+    
+    float pairs = float((order * (order - 1)) / 2);
+    return pairs == 0 || float(edges) / pairs < 0.75;
+}
+
 Score Solver::choose_last_parentset() {
     uint var = 0;
     while(state.contains(var))
         var++;
     
-    if(state.score + instance.domains[var][0].score <= lb_solution.score) {
+    if(state.score + instance.domains[var][0].score <= lowerbound()) {
         verbose("Closing branch: At bottom\n");
+        stats.profile.prune(N - 1, Profile::AtBottom);
         return -INF;
     }
 
     size_t pset = bounds.best_final_parentset(var);
-    if(state.score + instance.domains[var][pset].score <= lb_solution.score) {
+    if(state.score + instance.domains[var][pset].score <= lowerbound()) {
         verbose("Closing branch: At bottom\n");
+        stats.profile.prune(N - 1, Profile::AtBottom);
         return -INF;
     }
 
     state[var].depth = DomainBuilder::get_depth(state, instance.domains[var][pset]);
     state[var].parentset = pset;
 
-    lb_solution = state;
-    lb_solution.score += instance.domains[var][pset].score;
-    lb_solution.set_parents(var, instance.domains[var][pset]);
-    output_lowerbound("New LB");
+    Solution candidate = state;
+    candidate.score += instance.domains[var][pset].score;
+    candidate.set_parents(var, instance.domains[var][pset]);
+    incumbent.offer(candidate, [&]() {
+        lb_solution = candidate;
+        output_lowerbound("New LB");
+    });
     return instance.domains[var][pset].score;
 }
 
-void Solver::track_skeletons() {
-    auto it = skeleton_memo.find(state.skeleton);
-    if(it != skeleton_memo.end())
-        stats.skeleton_hits++;
-    else
-        skeleton_memo.insert(std::make_pair(state.skeleton, state));
-}
-
-Score Solver::solve(uint order, size_t edges) {
+Score Solver::solve(uint order) {
     open_indent_scope();
     stats.layer_visits[order]++;
+    if(poll_countdown && --poll_countdown == 0)
+        poll();
 
-    if(flags[MemoizeSkeletons])
-        track_skeletons();
-    
     if(order == N - 1)
         return choose_last_parentset();
 
-    Score original_lb = lb_solution.score;
+    // The perfect orderings that survive the depth, index and lexicographic rules give
+    // each skeleton a single DAG and reach it once, so there is no subtree to reuse.
+    // -s only counts the skeletons that recur, which would break those rules.
+    if(flags[MemoizeSkeletons] && skeleton_memo.recurs(state.hash)) {
+        verbose("The skeleton has been reached before.\n");
+        stats.recurring_skeletons++;
+    }
+
+    Score original_lb = lowerbound();
     Score local_maximum = -INF;
 
-    Score ub = bounds.fast_upperbound();
-    if(ub <= lb_solution.score) {
+    Score ub = fast_upperbound();
+    if(ub <= original_lb) {
         verbose("Closing branch: UB <= LB\n");
+        stats.profile.prune(order, Profile::Upperbound);
         return -INF;
     }
 
-    if(flags[TightUpperbounds] && N - order < 10 && N - order > 3) {
-        float density = float(edges) / float((order * (order - 1)) / 2);
-        
-        if(density < 0.75) {
-            Score ub2 = bounds.tight_upperbound(10, lb_solution.score);
-
-            stats.tight_UBs++;
-            if(ub2 <= lb_solution.score) {
-                stats.successful_tight_UBs++;
-                verbose("Closing branch: Tight UB <= LB\n");
-                return ub2;
-            }
+    if(flags[TightUpperbounds] && tight_bound_pays_off(order)) {
+        Score ub2 = tight_upperbound();
+
+        stats.tight_UBs++;
+        if(ub2 <= lowerbound()) {
+            stats.successful_tight_UBs++;
+            verbose("Closing branch: Tight UB <= LB\n");
+            stats.profile.prune(order, Profile::TightUpperbound);
+            return ub2 - state.score;
         }
     }
     
-    ValueCalculator value_calc = [&](uint var, size_t pset) {
-        state.assign_mask.set(var);
-        Score value = instance.domains[var][pset].score + bounds.fast_upperbound();
-        state.assign_mask.reset(var);
-        return value;
-    };
-
     DomainBuilder options(instance, state,
-        flags[SortByUpperbounds] && order <= N / 2?
-            &value_calc: nullptr, N);
-
-    for(uint var = 0; var < N; var++)
-        if(!state.contains(var))
-            options.construct_for(var);
+        flags[SortByUpperbounds] && order <= N / 2? &bounds: nullptr,
+        lowerbound(), N, option_buffers[order], bound_buffers[order], superset_scores);
+    {
+        ProfileTimer timer(stats.profile, Profile::OptionLists);
+        for(uint var = 0; var < N; var++)
+            if(!state.contains(var))
+                options.construct_for(var);
+        options.sort();
+    }
+    stats.profile.option_list(options.list().size());
 
     if(flags[MemoizeOptions] && order <= N - 3) {
-        auto match = option_memo.find(options.list());
-        if(match != option_memo.end() && match->second + state.score <= lb_solution.score) {
+        ProfileTimer timer(stats.profile, Profile::MemoLookups);
+        Score memoized;
+        if(option_memo.find(options.key(), memoized) && memoized + state.score <= lowerbound()) {
             verbose("Closing branch: The memoized local maximum is low enough.\n");
             stats.option_hits++;
-            return match->second;
+            stats.profile.prune(order, Profile::OptionCache);
+            return memoized;
         }
     }
 
     verbose("Iterating through % options:\n",
         options.list().size());
 
-    assert(!options.list().empty());
+    if(pool && order < root_order + settings.split_depth) {
+        split(options.list());
+        return ub - state.score;
+    }
 
-    for(size_t option: options.list()) {
+    size_t depth = path.size(), first = 0;
+    if(depth < resume_positions.size()) {
+        first = resume_positions[depth];
+        // Options left out under the current LB are the tail of the sorted list,
+        // so when the checkpointed one is among them, this node is finished.
+        if(first >= options.list().size()) {
+            first = options.list().size();
+            resume_positions.resize(depth);
+        } else if(options.list()[first].option != resume_options[depth]) {
+            print("The search tree differs from the one in the checkpoint.\n");
+            std::exit(-1);
+        }
+    }
 
-        uint var = option / instance.domains[0].size();
-        size_t pset = option % instance.domains[0].size();
+    for(size_t i = first; i < options.list().size(); i++) {
+        size_t option = options.list()[i].option;
+        positions[depth] = i;
 
-        Score original_score = state.score;
-        state[var].parentset = pset;
-        state[var].depth = DomainBuilder::get_depth(state, instance.domains[var][pset]);
-        state.score += instance.domains[var][pset].score;
+        uint var = instance.option_var(option);
+        size_t pset = instance.option_pset(option);
 
-        state.set_parents(var, instance.domains[var][pset]);
+        Score original_score = state.score;
+        assign(option);
         verbose("Trying p_% <- [%] at position % in the ordering:\n",
             var, instance.domains[var][pset], order);
 
-        Score result = solve(order + 1, edges + instance.domains[var][pset].count());
+        Score result = solve(order + 1);
         if(local_maximum < instance.domains[var][pset].score + result)
             local_maximum = instance.domains[var][pset].score + result;
 
-        state.score = original_score;
-        state.reset_parents(var);
+        unassign(option, original_score);
+        if(resume_positions.size() > depth)
+            resume_positions.resize(depth);
         
-        if(original_lb != lb_solution.score) {
-            if(bounds.fast_upperbound() <= lb_solution.score) {
+        Score lb = lowerbound();
+        if(original_lb != lb) {
+            if(fast_upperbound() <= lb) {
                 verbose("Closing branch: UB <= LB\n");
+                stats.profile.prune(order, Profile::RaisedLowerbound);
                 break;
             }
-            original_lb = lb_solution.score;
+            original_lb = lb;
         }
     }
 
-    if(flags[MemoizeOptions] && order <= N - 3) {
-        if(local_maximum == -INF)
-            local_maximum = ub - state.score;
+    // The options skipped on resuming are only bounded by the UB
+    if(local_maximum == -INF || first != 0)
+        local_maximum = ub - state.score;
+    if(flags[MemoizeOptions] && order <= N - 3)
+        option_memo.store(options.key(), N - order, local_maximum);
+    return local_maximum;
+}
+
+// Pushes the children of the current state whose bounds beat the incumbent.
+void Solver::expand(uint order, std::vector<FrontierNode>& frontier, size_t& memory) {
+    stats.layer_expansions[order]++;
+    
+    if(flags[TightUpperbounds] && tight_bound_pays_off(order)) {
+        stats.tight_UBs++;
+        if(tight_upperbound() <= lowerbound()) {
+            stats.successful_tight_UBs++;
+            return;
+        }
+    }
+    
+    DomainBuilder options(instance, state, &bounds, lowerbound(), N,
+        option_buffers[order], bound_buffers[order], superset_scores);
+    {
+        ProfileTimer timer(stats.profile, Profile::OptionLists);
+        for(uint var = 0; var < N; var++)
+            if(!state.contains(var))
+                options.construct_for(var);
+    }
+    stats.profile.option_list(options.list().size());
+    
+    for(const Option& candidate: options.list()) {
+        Score original_score = state.score;
+        assign(candidate.option);
+        
+        frontier.push_back(FrontierNode {candidate.key, path});
+        std::push_heap(frontier.begin(), frontier.end());
+        memory += frontier.back().memory();
         
-        auto pair = option_memo.insert(std::make_pair(options.list(), local_maximum));
-        if(!pair.second && pair.first->second > local_maximum) {
-            verbose("Improved the memoized local maximum (% -> %).\n",
-                pair.first->second, local_maximum);
-            pair.first->second = local_maximum;
+        unassign(candidate.option, original_score);
+    }
+    stats.frontier_peak = max(stats.frontier_peak, frontier.size());
+}
+
+// Expands partial solutions in the order of their upper bounds. Nodes near the
+// leaves, and every node popped while the frontier is over --frontier-mb, are
+// searched depth-first instead, so memory stays bounded.
+void Solver::best_first() {
+    std::vector<FrontierNode> frontier;
+    frontier.push_back(FrontierNode {bounds.fast_upperbound(), path});
+    size_t memory = frontier.back().memory();
+    size_t budget = settings.frontier_mb << 20;
+    
+    Score root_score = state.score;
+    while(!frontier.empty()) {
+        std::pop_heap(frontier.begin(), frontier.end());
+        FrontierNode node = std::move(frontier.back());
+        frontier.pop_back();
+        memory -= node.memory();
+        
+        if(node.bound <= lowerbound()) {
+            verbose("Closing the frontier: UB <= LB\n");
+            break;
         }
+        global_ub = node.bound;
+        if(poll_countdown && --poll_countdown == 0)
+            poll();
+        
+        for(size_t option: node.path)
+            assign(option);
+        
+        uint order = root_order + node.path.size();
+        if(order + 2 >= N || memory >= budget) {
+            stats.depth_first_subtrees++;
+            solve(order);
+        } else
+            expand(order, frontier, memory);
+        
+        for(size_t i = node.path.size(); i-- > 0;)
+            unassign(node.path[i], root_score);
+    }
+}
+
+std::string search_flags(const std::bitset<32>& flags) {
+    std::string symbols;
+    for(uint i = 0; i < flag_symbols.length(); i++)
+        if(flags[i] && i != MinVerbosity && i != MaxVerbosity)
+            symbols += flag_symbols[i];
+    return symbols.empty()? "-": symbols;
+}
+
+void Solver::poll() {
+    poll_countdown = POLL_INTERVAL;
+    size_t now = get_time();
+    
+    size_t visits = stats.visits();
+    for(size_t expansions: stats.layer_expansions)
+        visits += expansions;
+    context.visits += visits - reported_visits;
+    reported_visits = visits;
+    
+    if(settings.progress_ms && worker == 0 && now >= next_progress) {
+        output_progress();
+        next_progress = now + settings.progress_ms;
+    }
+    if(settings.checkpoint != "" && !flags[BestFirst] &&
+            (termination_requested() || now >= next_checkpoint))
+        save_checkpoint();
+}
+
+// One JSON object per line on stderr. The UB is the root bound during a
+// depth-first search and the best open bound of the frontier with -b.
+void Solver::output_progress() {
+    size_t time = stats.time(), visits = context.visits.load();
+    double speed = time > progress_time?
+        double(visits - progress_visits) * 1000 / double(time - progress_time): 0;
+    progress_visits = visits;
+    progress_time = time;
+    
+    Score lb = lowerbound(), ub = max(global_ub, lb);
+    std::cerr << format("{\"time_ms\": %, \"nodes\": %, \"nodes_per_s\": %, ",
+            time, visits, size_t(speed))
+        << format("\"lb\": %, \"ub\": %, \"gap\": %, \"resident_mb\": %}",
+            to_string(lb), to_string(ub), to_string((ub - lb) / -lb),
+            resident_memory() >> 20)
+        << std::endl;
+}
+
+void Solver::save_checkpoint() {
+    Checkpoint checkpoint;
+    checkpoint.instance = absolute_path(settings.input);
+    checkpoint.checksum = instance.checksum();
+    checkpoint.flags = search_flags(flags);
+    checkpoint.variables = N;
+    checkpoint.positions.assign(positions.begin(), positions.begin() + path.size());
+    checkpoint.options = path;
+    
+    Solution best = incumbent.solution();
+    checkpoint.score = best.score;
+    for(uint var = 0; var < N; var++)
+        checkpoint.parentsets.push_back(best[var].parentset);
+    
+    checkpoint.elapsed = stats.time();
+    checkpoint.layer_visits = stats.layer_visits;
+    checkpoint.recurring_skeletons = stats.recurring_skeletons;
+    checkpoint.option_hits = stats.option_hits;
+    checkpoint.tight_UBs = stats.tight_UBs;
+    checkpoint.successful_tight_UBs = stats.successful_tight_UBs;
+    
+    bool written = checkpoint.write(settings.checkpoint);
+    next_checkpoint = get_time() + settings.checkpoint_s * 1000;
+    if(!written)
+        print("Couldn't write the checkpoint '%'.\n", settings.checkpoint);
+    
+    if(termination_requested()) {
+        if(improver)
+            improver->stop();
+        if(written)
+            print("Interrupted; resume with --resume %\n", settings.checkpoint);
+        std::exit(-1);
     }
-    return local_maximum;
+}
+
+void Solver::restore_checkpoint() {
+    Checkpoint checkpoint;
+    if(!checkpoint.read(settings.resume) || checkpoint.variables != N ||
+            checkpoint.flags != search_flags(flags)) {
+        print("Couldn't resume from '%'; it's unreadable or was written with other flags.\n",
+            settings.resume);
+        std::exit(-1);
+    }
+    if(checkpoint.checksum != instance.checksum()) {
+        print("Couldn't resume from '%'; it was written for other scores than '%'.\n",
+            settings.resume, settings.input);
+        std::exit(-1);
+    }
+    
+    bool valid = checkpoint.positions.size() < N;
+    for(size_t option: checkpoint.options)
+        valid = valid && instance.option_var(option) < N &&
+            instance.option_pset(option) < instance.domains[instance.option_var(option)].size();
+    if(checkpoint.score != -INF)
+        for(uint var = 0; var < N; var++)
+            valid = valid && checkpoint.parentsets[var] < instance.domains[var].size();
+    if(!valid) {
+        print("Couldn't resume from '%'; it refers to parent sets the instance doesn't have.\n",
+            settings.resume);
+        std::exit(-1);
+    }
+    
+    resume_positions = checkpoint.positions;
+    resume_options = checkpoint.options;
+    
+    if(checkpoint.score != -INF) {
+        ArcMatrix matrix(N, VarSet());
+        for(uint var = 0; var < N; var++)
+            matrix[var] = instance.domains[var][checkpoint.parentsets[var]].content;
+        Solution restored = Solution::construct(instance.domains, instance.domain_lookup,
+            Network(std::move(matrix), checkpoint.score));
+        incumbent.offer(restored, [&]() {
+            lb_solution = restored;
+            output_lowerbound("Resumed LB");
+        });
+    }
+    
+    stats.start_time -= checkpoint.elapsed;
+    for(uint i = 0; i < N; i++)
+        stats.layer_visits[i] += checkpoint.layer_visits[i];
+    stats.recurring_skeletons += checkpoint.recurring_skeletons;
+    stats.option_hits += checkpoint.option_hits;
+    stats.tight_UBs += checkpoint.tight_UBs;
+    stats.successful_tight_UBs += checkpoint.successful_tight_UBs;
+}
+
+double Solver::option_hit_rate() const {
+    TranspositionTable::Counters memo = stats.merged_memo;
+    memo.merge(option_memo.counters());
+    return double(stats.option_hits) / double(max(memo.lookups, 1));
+}
+
+double Solver::skeleton_recurrence_rate() const {
+    size_t skeletons = skeleton_memo.size() + stats.merged_skeletons;
+    return double(stats.recurring_skeletons) / double(max(skeletons, 1));
 }
 
 void Solver::output_statistics() {
     print("Search statistics:\n");
     print("  Used % (after the input was read)\n", formatted_time(stats.time()));
     print("  Solution fingerprint: '%'\n", lb_solution.fingerprint());
+    if(bayes_solver.is_filled())
+        print("  Filled the Bayes table in % (% threads)\n",
+            formatted_time(stats.bayes_time), settings.threads);
+    else
+        print("  Bayes table exceeded --bayes-mb; bounded with unconstrained parent sets\n");
+    const char * representations[] = {"16-bit", "32-bit", "sparse"};
+    print("  Best parent set tables: % (% MB)\n",
+        representations[instance.score_tree[0].representation()],
+        instance.tree_memory() >> 20);
+    
+    if(const MappedFile * mapping = bayes_solver.mapping())
+        print("  Bayes table: % MB of float32 mapped from '%' (%, % % resident)\n",
+            mapping->size() >> 20, mapping->path(),
+            bayes_solver.was_reused()? "reused": "created",
+            mapping->residency() * 100);
+    print("  Page faults during the search: % major, % minor\n",
+        stats.major_faults, stats.minor_faults);
     
     print("  Gaps:\n");
     print("    Initial UB/Initial LB: % %\n", stats.UB / stats.LB * 100);
     print("    Optimal/Initial LB: % %\n", lb_solution.score / stats.LB * 100);
 
-    size_t total_visits = 0;
-    for(uint i = 0; i < N; i++)
-        total_visits += stats.layer_visits[i];
+    size_t total_visits = stats.visits();
 
-    if(skeleton_memo.size() != 0) {
-        double skeleton_ratio = double(stats.skeleton_hits) / double(skeleton_memo.size());
-        print("  Hits to skeleton cache: %/% (% %)\n",
-            stats.skeleton_hits, skeleton_memo.size(), skeleton_ratio * 100);
-    }
-    if(stats.option_hits != 0) {
-        double option_ratio = double(stats.option_hits) / double(option_memo.size());
+    size_t skeletons = skeleton_memo.size() + stats.merged_skeletons;
+    size_t option_lists = option_memo.size() + stats.merged_option_lists;
+
+    if(skeletons != 0)
+        print("  Recurring skeletons: %/% (% %)\n",
+            stats.recurring_skeletons, skeletons, skeleton_recurrence_rate() * 100);
+    if(option_memo.is_allocated()) {
+        TranspositionTable::Counters memo = stats.merged_memo;
+        memo.merge(option_memo.counters());
         print("  Hits to option cache: %/% (% %)\n",
-            stats.option_hits, option_memo.size(), option_ratio * 100);
+            stats.option_hits, memo.lookups, option_hit_rate() * 100);
+        print("  Option cache: % lists in % MB; % matches, % collisions, % evictions\n",
+            option_lists, (option_memo.memory() * settings.threads) >> 20,
+            memo.matches, memo.collisions, memo.evictions);
     }
+    if(improver)
+        print("  Incumbents found by local search: %\n", stats.local_improvements);
     if(stats.tight_UBs != 0) {
         print("  Tight UB closing a branch: %/% (% %) (after normal UB had failed to do so)\n",
             stats.successful_tight_UBs, stats.tight_UBs,
@@ -275,8 +744,56 @@ void Solver::output_statistics() {
     
     double speed = int(double(total_visits) / (double(stats.time()) / 1000));
     print("  Visited % search tree nodes (% nodes/s)\n", total_visits, speed);
+    print("  Heap allocations during the search: % (% per node)\n",
+        stats.allocations, double(stats.allocations) / double(max(total_visits, 1)));
     print("  Visit distribution per search tree layer: ");
     for(uint i = 0; i < N; i++)
         print_visits(i);
     print("\n");
+    
+    if(flags[BestFirst]) {
+        size_t expansions = 0;
+        for(uint i = 0; i < N; i++)
+            expansions += stats.layer_expansions[i];
+        print("  Expanded % nodes best-first (frontier peak % nodes, % subtrees searched depth-first)\n",
+            expansions, stats.frontier_peak, stats.depth_first_subtrees);
+        print("  Expansions per search tree layer: ");
+        for(uint i = 0; i < N; i++) {
+            if(i % 4 == 0)
+                print("\n");
+            std::string s = format("    %%: %", i < 10? " ": "", i, stats.layer_expansions[i]);
+            while(s.length() < 20)
+                s += " ";
+            print(s);
+        }
+        print("\n");
+    }
+    if(settings.profile)
+        output_profile();
+}
+
+void Solver::output_profile() {
+    const Profile& profile = stats.profile;
+    
+    print("Profile:\n");
+    print("  Time per part of the search (summed over threads):\n");
+    for(uint i = 0; i < Profile::Sections; i++)
+        print("    %: % ms in % calls\n", Profile::section_names[i],
+            profile.nanoseconds[i] / 1000000, profile.calls[i]);
+    
+    print("  Branches closed per search tree layer:\n    layer");
+    for(uint reason = 0; reason < Profile::Prunes; reason++)
+        print("\t%", Profile::prune_names[reason]);
+    print("\n");
+    for(uint i = 0; i < N; i++) {
+        print("    %", i);
+        for(uint reason = 0; reason < Profile::Prunes; reason++)
+            print("\t%", profile.prunes[i * Profile::Prunes + reason]);
+        print("\n");
+    }
+    
+    print("  Option list sizes:\n");
+    for(uint b = 1; b < Profile::Buckets; b++)
+        if(profile.list_sizes[b])
+            print("    %-%: %\n", size_t(1) << (b - 1), (size_t(1) << b) - 1, profile.list_sizes[b]);
 }
@@ -0,0 +1,74 @@
+#include <TaskPool.hpp>
+
+TaskPool::TaskPool(uint workers): pending(0), version(0) {
+    for(uint i = 0; i < workers; i++)
+        queues.push_back(std::unique_ptr<Queue>(new Queue()));
+}
+
+void TaskPool::signal(bool everyone) {
+    {
+        std::lock_guard<std::mutex> lock(idle_guard);
+        version++;
+    }
+    if(everyone)
+        idle.notify_all();
+    else
+        idle.notify_one();
+}
+
+void TaskPool::push(uint worker, Task&& task) {
+    pending++;
+    {
+        std::lock_guard<std::mutex> lock(queues[worker]->guard);
+        queues[worker]->tasks.push_back(std::move(task));
+    }
+    signal(false);
+}
+
+bool TaskPool::take_own(uint worker, Task& task) {
+    std::lock_guard<std::mutex> lock(queues[worker]->guard);
+    if(queues[worker]->tasks.empty())
+        return false;
+    task = std::move(queues[worker]->tasks.back());
+    queues[worker]->tasks.pop_back();
+    return true;
+}
+
+bool TaskPool::steal(uint worker, Task& task) {
+    for(uint i = 1; i < workers(); i++) {
+        Queue& victim = * queues[(worker + i) % workers()];
+        std::lock_guard<std::mutex> lock(victim.guard);
+        if(victim.tasks.empty())
+            continue;
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+// The version is read before looking at the queues, so a push that comes after
+// the search but before the wait is not missed.
+bool TaskPool::take(uint worker, Task& task) {
+    while(true) {
+        size_t seen;
+        {
+            std::lock_guard<std::mutex> lock(idle_guard);
+            seen = version;
+        }
+        if(take_own(worker, task) || steal(worker, task))
+            return true;
+        
+        std::unique_lock<std::mutex> lock(idle_guard);
+        idle.wait(lock, [&]() {
+            return version != seen || pending.load() == 0;
+        });
+        if(pending.load() == 0)
+            return false;
+    }
+}
+
+void TaskPool::finish() {
+    if(--pending == 0)
+        signal(true);
+}
@@ -0,0 +1,112 @@
+#include <TranspositionTable.hpp>
+
+TranspositionTable::TranspositionTable():
+    count {0, 0, 0, 0},
+    used(0),
+    generation(1) {}
+
+void TranspositionTable::Counters::merge(const Counters& other) {
+    lookups += other.lookups;
+    matches += other.matches;
+    collisions += other.collisions;
+    evictions += other.evictions;
+}
+
+// A table that already has the size is only cleared, so reusing it costs nothing.
+void TranspositionTable::allocate(size_t bytes) {
+    size_t size = 1;
+    while(size * 2 * sizeof(Bucket) <= bytes)
+        size *= 2;
+    if(bytes < sizeof(Bucket))
+        size = 0;
+    
+    count = Counters {0, 0, 0, 0};
+    if(size != 0 && buckets.size() == size) {
+        clear();
+        return;
+    }
+    buckets.assign(size, Bucket());
+    used = 0;
+    generation = 1;
+}
+
+void TranspositionTable::clear() {
+    used = 0;
+    if(++generation == 0) {
+        buckets.assign(buckets.size(), Bucket());
+        generation = 1;
+    }
+}
+
+bool TranspositionTable::find(const Fingerprint& key, Score& value) {
+    if(buckets.empty())
+        return false;
+    count.lookups++;
+    Bucket& b = bucket(key);
+    
+    for(Entry * entry: {&b.deep, &b.recent})
+        if(!is_empty(* entry) && entry->key == key) {
+            count.matches++;
+            value = entry->value;
+            return true;
+        }
+    
+    if(!is_empty(b.deep) || !is_empty(b.recent))
+        count.collisions++;
+    return false;
+}
+
+void TranspositionTable::replace(Entry& old, const Entry& entry) {
+    if(is_empty(old))
+        used++;
+    else
+        count.evictions++;
+    old = entry;
+}
+
+// Values are upper bounds, so the smaller one is kept when a fingerprint is stored again.
+// The depth is the number of variables left to place, i.e. the size of the subtree.
+void TranspositionTable::store(const Fingerprint& key, uint depth, Score value) {
+    if(buckets.empty())
+        return;
+    Bucket& b = bucket(key);
+    Entry entry {key, value, depth, generation};
+    
+    for(Entry * old: {&b.deep, &b.recent})
+        if(!is_empty(* old) && old->key == key) {
+            if(old->value > value)
+                old->value = value;
+            if(old->depth < entry.depth)
+                old->depth = entry.depth;
+            return;
+        }
+    
+    if(is_empty(b.deep) || b.deep.depth <= depth) {
+        if(!is_empty(b.deep))
+            replace(b.recent, b.deep);
+        else
+            used++;
+        b.deep = entry;
+    } else
+        replace(b.recent, entry);
+}
+
+void SkeletonTable::allocate(size_t bytes) {
+    size_t size = 1;
+    while(size * 2 * sizeof(uint64_t) <= bytes)
+        size *= 2;
+    hashes.assign(bytes < sizeof(uint64_t)? 0: size, 0);
+    checked = 0;
+}
+
+// Records the hash and tells whether it was already recorded.
+bool SkeletonTable::recurs(uint64_t hash) {
+    if(hashes.empty() || !hash)
+        return false;
+    checked++;
+    uint64_t& entry = hashes[hash & (hashes.size() - 1)];
+    if(entry == hash)
+        return true;
+    entry = hash;
+    return false;
+}
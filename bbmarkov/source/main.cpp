@@ -1,39 +1,151 @@
 #include <Solver.hpp>
+#include <ParallelSolver.hpp>
+#include <BatchSolver.hpp>
+#include <Benchmark.hpp>
+#include <CliqueTreeSolver.hpp>
+#include <ScoreFile.hpp>
 #include <iomanip>
 #include <debug.hpp>
 #include <cstdlib>
 
-std::bitset<32> parse_flags(int argc, char ** argv) {
-    std::bitset<32> flags;
-    for(size_t i = 0; i < argc; i++) {
-        if(argv[i][0] != '-')
+void parse_flags(char * arg, Settings& settings) {
+    for(arg++; * arg; arg++) {
+        if(flag_symbols.find(* arg) == -1) {
+            print("Unrecognized flag '-%'.\n", * arg);
+            std::exit(-1);
+        }
+        settings.flags[flag_symbols.find(* arg)] = true;
+    }
+}
+
+bool parse_value(const std::string& name, const std::string& value, Settings& settings) {
+    if(name == "-j")
+        settings.threads = std::max(1, std::atoi(value.c_str()));
+    else if(name == "--split")
+        settings.split_depth = std::max(1, std::atoi(value.c_str()));
+    else if(name == "--tree-mb")
+        settings.tree_mb = std::atoll(value.c_str());
+    else if(name == "--bayes-mb")
+        settings.bayes_mb = std::atoll(value.c_str());
+    else if(name == "--memo-mb")
+        settings.memo_mb = std::atoll(value.c_str());
+    else if(name == "--frontier-mb")
+        settings.frontier_mb = std::atoll(value.c_str());
+    else if(name == "--dp-mb")
+        settings.dp_mb = std::atoll(value.c_str());
+    else if(name == "--bayes-file")
+        settings.bayes_file = value;
+    else if(name == "--convert")
+        settings.convert = value;
+    else if(name == "--batch")
+        settings.batch = value;
+    else if(name == "--checkpoint")
+        settings.checkpoint = value;
+    else if(name == "--checkpoint-s")
+        settings.checkpoint_s = std::atoll(value.c_str());
+    else if(name == "--resume")
+        settings.resume = value;
+    else if(name == "--initial")
+        settings.initial = value;
+    else if(name == "--generate")
+        settings.generate = value;
+    else if(name == "--gen-variables")
+        settings.generator.variables = std::atoi(value.c_str());
+    else if(name == "--gen-pset")
+        settings.generator.max_pset = std::atoi(value.c_str());
+    else if(name == "--gen-arity")
+        settings.generator.arity = std::atoi(value.c_str());
+    else if(name == "--gen-noise")
+        settings.generator.noise = std::atof(value.c_str());
+    else if(name == "--gen-seed")
+        settings.generator.seed = std::atoll(value.c_str());
+    else if(name == "--benchmark")
+        settings.benchmark = value;
+    else if(name == "--flag-sets")
+        settings.flag_sets = value;
+    else if(name == "--progress")
+        settings.progress_ms = std::max(1.0, std::atof(value.c_str()) * 1000);
+    else
+        return false;
+    return true;
+}
+
+Settings parse_settings(int argc, char ** argv, std::string& fname) {
+    Settings settings;
+    for(size_t i = 1; i < argc; i++) {
+        if(!argv[i][0])
+            continue;
+        if(argv[i][0] != '-') {
+            fname = argv[i];
             continue;
-        char * orig = argv[i];
-        for(argv[i]++; * argv[i]; argv[i]++) {
-            if(flag_symbols.find(* argv[i]) == -1) {
-                print("Unrecognized flag '-%'.\n", * argv[i]);
-                std::exit(-1);
-            }
-            flags[flag_symbols.find(* argv[i])] = true;
         }
-        argv[i] = orig;
+        if(i + 1 < argc && parse_value(argv[i], argv[i + 1], settings)) {
+            i++;
+            continue;
+        }
+        if(std::string(argv[i]) == "--profile") {
+            settings.profile = true;
+            continue;
+        }
+        if(argv[i][1] == '-') {
+            print("Unrecognized option '%'.\n", argv[i]);
+            std::exit(-1);
+        }
+        parse_flags(argv[i], settings);
     }
-    return flags;
+    return settings;
 }
 
 int main(int argc, char ** argv) {
     
     std::string fname;
-    for(size_t i = 1; i < argc; i++)
-        if(argv[i][0] && argv[i][0] != '-')
-            fname = argv[i];
+    Settings settings = parse_settings(argc, argv, fname);
+    auto flags = settings.flags;
+    
+    if(settings.resume != "") {
+        Checkpoint checkpoint;
+        if(!checkpoint.read(settings.resume)) {
+            print("Couldn't read the checkpoint '%'.\n", settings.resume);
+            std::exit(-1);
+        }
+        if(fname == "")
+            fname = checkpoint.instance;
+        if(settings.checkpoint == "")
+            settings.checkpoint = settings.resume;
+    }
+    settings.input = fname;
     
-    auto flags = parse_flags(argc, argv);
-    if(fname != "") {        
+    if(settings.generate != "") {
+        if(!generate_scores(settings.generate, settings.generator)) {
+            print("Couldn't write '%' with the given generator settings.\n", settings.generate);
+            std::exit(-1);
+        }
+        print("Wrote % variables with parent sets of at most % to '%'.\n",
+            settings.generator.variables, settings.generator.max_pset, settings.generate);
+    } else if(settings.benchmark != "") {
+        Benchmark benchmark(settings, settings.flag_sets);
+        if(!benchmark.read_manifest(settings.benchmark)) {
+            print("Couldn't open '%'.\n", settings.benchmark);
+            std::exit(-1);
+        }
+        benchmark.run();
+    } else if(settings.batch != "") {
+        BatchSolver solver(settings);
+        if(!solver.read_manifest(settings.batch)) {
+            print("Couldn't open '%'.\n", settings.batch);
+            std::exit(-1);
+        }
+        solver.solve();
+    } else if(fname != "") {        
         if(!flags[MinVerbosity])
             print("Reading the input file... ");
 
-        Instance instance(fname);
+        Instance instance(fname, settings.tree_mb << 20);
+        if(instance.domains.size() > VARIABLES) {
+            print("The instance has % variables, but this build supports at most %.\n"
+                "Rebuild with 'make clean; make VARIABLES=128'.\n", instance.domains.size(), VARIABLES);
+            std::exit(-1);
+        }
         if(!instance.is_valid()) {
             print("Couldn't open '%' or its contents are invalid.\n", fname);
             std::exit(-1);
@@ -42,15 +154,96 @@ int main(int argc, char ** argv) {
         if(!flags[MinVerbosity])
             print("Done.\n");
         
-        Solver solver(flags, instance, instance.domains.size());
-        solver.solve();
+        if(settings.convert != "") {
+            if(!write_binary_scores(settings.convert, instance.domains)) {
+                print("Couldn't write '%'.\n", settings.convert);
+                std::exit(-1);
+            }
+            print("Wrote the scores of % variables to '%'.\n",
+                instance.domains.size(), settings.convert);
+            return 0;
+        }
+        
+        if(flags[CliqueTrees]) {
+            std::string reason;
+            CliqueTreeSolver solver(settings, instance);
+            if(solver.prepare(reason)) {
+                solver.solve();
+                return 0;
+            }
+            print("Not solving with the clique tree DP: %.\n\n", reason);
+        }
+        
+        if(settings.checkpoint != "" && (settings.threads > 1 || flags[BestFirst])) {
+            print("Only the sequential depth-first search is checkpointed; "
+                "use --checkpoint and --resume without -j and -b.\n");
+            std::exit(-1);
+        }
+        
+        if(settings.threads > 1 && !flags[BestFirst]) {
+            ParallelSolver solver(settings, instance, instance.domains.size());
+            solver.solve();
+        } else {
+            Solver solver(settings, instance, instance.domains.size());
+            solver.solve();
+        }
     } else
-        print("Usage: % [flags] <file>\n\n"
+        print("Usage: % [flags] <file>\n"
+            "       % [flags] --batch <manifest>\n"
+            "       % [options] --benchmark <manifest>\n"
+            "       % --generate <file> [generator options]\n\n"
             "Flags:\n"
             "  -v    Minimal verbosity\n"
-            "  -s    Keep track of the number of recurring skeletons (for debugging purposes)\n"
+            "  -s    Count the skeletons that are reached more than once (a check of the\n"
+            "        search rules, which reach each skeleton once; nothing is pruned)\n"
             "  -o    Prune recurring option lists\n"
             "  -t    Use tight upper bounds that take immoralities into consideration\n"
-            "  -f    Fix an arbitrary variable to be the first in the ordering\n\n"
-            "Recommended flags are -ft. (-o is good with some instances)\n", argv[0]);
-}
\ No newline at end of file
+            "  -f    Fix an arbitrary variable to be the first in the ordering\n"
+            "  -u    Sort the options by their upper bounds\n"
+            "  -l    Improve the incumbent with local search in a background thread\n"
+            "  -b    Expand the nodes best-first by their upper bounds (not split with -j)\n"
+            "  -c    Solve exactly by dynamic programming over junction trees; for instances\n"
+            "        of at most 18 variables with score-equivalent scores that list every\n"
+            "        parent set up to the limit (the branch and bound is used otherwise)\n\n"
+            "Options:\n"
+            "  -j <threads>      Solve with work-stealing threads (default: 1)\n"
+            "  --split <depth>   Number of search tree layers split into tasks with -j (default: 2)\n"
+            "  --tree-mb <MB>    Memory budget of the best parent set tables; larger instances\n"
+            "                    scan the sorted domains instead (default: 4096)\n"
+            "  --bayes-mb <MB>   Memory budget of the Bayes bound table; larger instances are\n"
+            "                    bounded with unconstrained parent sets (default: 16384)\n"
+            "  --memo-mb <MB>    Size of each table of recurring option lists (-o); old\n"
+            "                    entries are replaced (default: 256)\n"
+            "  --frontier-mb <MB> Memory budget of the -b frontier; over it, nodes are searched\n"
+            "                    depth-first (default: 1024)\n"
+            "  --dp-mb <MB>      Memory budget of the -c tables (default: 4096)\n"
+            "  --bayes-file <f>  Keep the Bayes bound table as float32 in a memory-mapped file\n"
+            "                    that is reused by later runs on the same scores\n"
+            "  --convert <f>     Write the scores in the binary format to <f> and exit;\n"
+            "                    binary score files are detected and loaded without parsing\n"
+            "  --checkpoint <f>  Write the state of the search to <f> every --checkpoint-s\n"
+            "                    seconds (default: 600) and on SIGTERM; not with -j or -b\n"
+            "  --resume <f>      Continue the search saved in the checkpoint <f>, which\n"
+            "                    also names the input file; needs the same flags\n"
+            "  --initial <f>     Start from the chordal network in <f> as the incumbent; each\n"
+            "                    line lists vertices that are pairwise adjacent, such as an\n"
+            "                    edge \"3 7\" or a clique \"{1, 4, 5}\"\n"
+            "  --profile         Time the parts of the search and count closed branches per\n"
+            "                    layer and option list sizes; reported with the statistics\n"
+            "  --progress <s>    Print a JSON line of progress to stderr every <s> seconds\n"
+            "  --batch <f>       Solve the score files listed in <f>, one per line, on -j\n"
+            "                    threads and print a line per file: score, time, nodes\n"
+            "                    and fingerprint\n"
+            "  --benchmark <f>   Solve the files listed in <f> with each of --flag-sets\n"
+            "                    (default: ft,fto,ftu,fo,fu,ftuo) and print CSV rows of\n"
+            "                    times, nodes, cache hit rates and peak memory\n\n"
+            "Generator options:\n"
+            "  --generate <f>       Write the scores of a random chordal network to <f>\n"
+            "  --gen-variables <n>  Number of variables (default: 12)\n"
+            "  --gen-pset <k>       Largest parent set (default: 2)\n"
+            "  --gen-arity <r>      Values per variable, which sets the parameter penalty\n"
+            "                       (default: 2)\n"
+            "  --gen-noise <s>      Deviation of the noise added to each set (default: 1)\n"
+            "  --gen-seed <x>       Random seed (default: 1)\n\n"
+            "Recommended flags are -ft. (-o is good with some instances)\n", argv[0], argv[0], argv[0], argv[0]);
+}